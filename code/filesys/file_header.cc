@@ -42,9 +42,14 @@ FileHeader::Allocate(Bitmap *freeMap, unsigned fileSize)
     raw.numSectors = DivRoundUp(fileSize, SECTOR_SIZE);
     if (freeMap->CountClear() < raw.numSectors)
         return false;  // Not enough space.
+    if (raw.numSectors == 0)
+        return true;
 
+    // Lay the file out sequentially if there is room for it, otherwise take
+    // whatever sectors are free.
+    int first = freeMap->FindRun(raw.numSectors);
     for (unsigned i = 0; i < raw.numSectors; i++)
-        raw.dataSectors[i] = freeMap->Find();
+        raw.dataSectors[i] = first != -1 ? first + i : freeMap->Find();
     return true;
 }
 
@@ -287,6 +287,26 @@ FileSystem::Remove(const char *name)
     return true;
 }
 
+/// Set aside `count` consecutive sectors that belong to no file.  They are
+/// marked in the free map, so files are never allocated on them.
+///
+/// Return the number of the first sector, or -1 if there is no such run.
+int
+FileSystem::ReserveSectors(unsigned count)
+{
+    ASSERT(count > 0);
+
+    Bitmap *freeMap = new Bitmap(NUM_SECTORS);
+    freeMap->FetchFrom(freeMapFile);
+    int first = freeMap->FindRun(count);
+    if (first != -1)
+        freeMap->WriteBack(freeMapFile);
+    delete freeMap;
+
+    DEBUG('f', "Reserving %u sectors at %d\n", count, first);
+    return first;
+}
+
 /// List all the files in the file system directory.
 void
 FileSystem::List()
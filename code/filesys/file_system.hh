@@ -100,6 +100,10 @@ public:
     /// Delete a file (UNIX `unlink`).
     bool Remove(const char *name);
 
+    /// Set aside `count` consecutive sectors that belong to no file, and
+    /// return the first, or -1 if there is no such run.
+    int ReserveSectors(unsigned count);
+
     /// List all the files in the file system.
     void List();
 
@@ -24,6 +24,7 @@ OpenFile::OpenFile(int sector)
 {
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    headerSector = sector;
     seekPosition = 0;
 }
 
@@ -109,8 +110,7 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
     ASSERT(numBytes > 0);
 
     unsigned fileLength = hdr->FileLength();
-    unsigned firstSector, lastSector, numSectors;
-    char *buf;
+    unsigned firstSector, lastSector;
 
     if (position >= fileLength)
         return 0;  // Check request.
@@ -121,17 +121,24 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
 
     firstSector = DivRoundDown(position, SECTOR_SIZE);
     lastSector = DivRoundDown(position + numBytes - 1, SECTOR_SIZE);
-    numSectors = 1 + lastSector - firstSector;
 
-    // Read in all the full and partial sectors that we need.
-    buf = new char [numSectors * SECTOR_SIZE];
-    for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                              &buf[(i - firstSector) * SECTOR_SIZE]);
-
-    // Copy the part we want.
-    memcpy(into, &buf[position - firstSector * SECTOR_SIZE], numBytes);
-    delete [] buf;
+    // Full sectors go straight into `into`; only the partial ones at either
+    // end need a bounce buffer.
+    char buf[SECTOR_SIZE];
+    for (unsigned i = firstSector; i <= lastSector; i++) {
+        unsigned start = i == firstSector ? position : i * SECTOR_SIZE;
+        unsigned end = i == lastSector ? position + numBytes
+                                       : (i + 1) * SECTOR_SIZE;
+        int sector = hdr->ByteToSector(i * SECTOR_SIZE);
+
+        if (end - start == SECTOR_SIZE)
+            synchDisk->ReadSector(sector, &into[start - position]);
+        else {
+            synchDisk->ReadSector(sector, buf);
+            memcpy(&into[start - position], &buf[start % SECTOR_SIZE],
+                   end - start);
+        }
+    }
     return numBytes;
 }
 
@@ -142,9 +149,7 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     ASSERT(numBytes > 0);
 
     unsigned fileLength = hdr->FileLength();
-    unsigned firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    unsigned firstSector, lastSector;
 
     if (position >= fileLength){
         // Fill with fillChar.
@@ -170,28 +175,26 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
 
     firstSector = DivRoundDown(position, SECTOR_SIZE);
     lastSector  = DivRoundDown(position + numBytes - 1, SECTOR_SIZE);
-    numSectors  = 1 + lastSector - firstSector;
-
-    buf = new char [numSectors * SECTOR_SIZE];
-
-    firstAligned = position == firstSector * SECTOR_SIZE;
-    lastAligned  = position + numBytes == (lastSector + 1) * SECTOR_SIZE;
-
-    // Read in first and last sector, if they are to be partially modified.
-    if (!firstAligned)
-        ReadAt(buf, SECTOR_SIZE, firstSector * SECTOR_SIZE);
-    if (!lastAligned && (firstSector != lastSector || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SECTOR_SIZE],
-               SECTOR_SIZE, lastSector * SECTOR_SIZE);
 
-    // Copy in the bytes we want to change.
-    memcpy(&buf[position - firstSector * SECTOR_SIZE], from, numBytes);
-
-    // Write modified sectors back.
-    for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                               &buf[(i - firstSector) * SECTOR_SIZE]);
-    delete [] buf;
+    // Full sectors are written straight from `from`; the partial ones at
+    // either end are read in first, so that we do not overwrite their
+    // unmodified portion.
+    char buf[SECTOR_SIZE];
+    for (unsigned i = firstSector; i <= lastSector; i++) {
+        unsigned start = i == firstSector ? position : i * SECTOR_SIZE;
+        unsigned end = i == lastSector ? position + numBytes
+                                       : (i + 1) * SECTOR_SIZE;
+        int sector = hdr->ByteToSector(i * SECTOR_SIZE);
+
+        if (end - start == SECTOR_SIZE)
+            synchDisk->WriteSector(sector, &from[start - position]);
+        else {
+            synchDisk->ReadSector(sector, buf);
+            memcpy(&buf[start % SECTOR_SIZE], &from[start - position],
+                   end - start);
+            synchDisk->WriteSector(sector, buf);
+        }
+    }
     return numBytes;
 }
 
@@ -201,3 +204,9 @@ OpenFile::Length() const
 {
     return hdr->FileLength();
 }
+
+unsigned long
+OpenFile::GetFileId() const
+{
+    return headerSector;
+}
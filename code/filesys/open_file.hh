@@ -79,6 +79,13 @@ public:
         return Tell(file);
     }
 
+    /// Return a number that is the same for every `OpenFile` of this file,
+    /// and different for any other file.
+    unsigned long GetFileId() const
+    {
+        return FileIdentity(file);
+    }
+
 private:
     int file;
     unsigned currentOffset;
@@ -114,8 +121,13 @@ public:
     // the UNIX idiom -- `lseek` to end of file, `tell`, `lseek` back).
     unsigned Length() const;
 
+    /// Return a number that is the same for every `OpenFile` of this file,
+    /// and different for any other file: the sector of its header.
+    unsigned long GetFileId() const;
+
   private:
     FileHeader *hdr;  ///< Header for this file.
+    int headerSector;  ///< Sector where `hdr` is stored.
     unsigned seekPosition;  ///< Current position within the file.
 };
 
@@ -14,6 +14,7 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
 
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
@@ -58,7 +59,7 @@ SynchDisk::ReadSector(int sectorNumber, char *data)
 
     lock->Acquire();  // Only one disk I/O at a time.
     disk->ReadRequest(sectorNumber, data);
-    semaphore->P();   // Wait for interrupt.
+    scheduler->WaitForDevice(semaphore);  // Wait for interrupt.
     lock->Release();
 }
 
@@ -74,7 +75,7 @@ SynchDisk::WriteSector(int sectorNumber, const char *data)
 
     lock->Acquire();  // only one disk I/O at a time
     disk->WriteRequest(sectorNumber, data);
-    semaphore->P();   // wait for interrupt
+    scheduler->WaitForDevice(semaphore);  // wait for interrupt
     lock->Release();
 }
 
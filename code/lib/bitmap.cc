@@ -21,8 +21,8 @@ Bitmap::Bitmap(unsigned nitems)
     numBits  = nitems;
     numWords = DivRoundUp(numBits, BITS_IN_WORD);
     map      = new unsigned [numWords];
-    for (unsigned i = 0; i < numBits; i++)
-        Clear(i);
+    for (unsigned i = 0; i < numWords; i++)
+        map[i] = 0;
 }
 
 /// De-allocate a bitmap.
@@ -68,11 +68,37 @@ Bitmap::Test(unsigned which) const
 int
 Bitmap::Find()
 {
-    for (unsigned i = 0; i < numBits; i++)
-        if (!Test(i)) {
-            Mark(i);
-            return i;
+    unsigned i = NextClear(0);
+    if (i == numBits)
+        return -1;
+
+    Mark(i);
+    return i;
+}
+
+/// Return the number of the first bit of the first run of `count` clear
+/// bits.  As a side effect, set the bits of the run.  (In other words,
+/// allocate `count` contiguous bits.)
+///
+/// If there is no such run, return -1.
+///
+/// * `count` is the length of the run.
+int
+Bitmap::FindRun(unsigned count)
+{
+    ASSERT(count > 0);
+
+    // Jump from each run of clear bits to the next one, skipping the set
+    // bits in between.
+    for (unsigned start = NextClear(0); start < numBits;
+         start = NextClear(NextSet(start))) {
+        unsigned end = NextSet(start);
+        if (end - start >= count) {
+            for (unsigned i = start; i < start + count; i++)
+                Mark(i);
+            return start;
         }
+    }
     return -1;
 }
 
@@ -81,12 +107,46 @@ Bitmap::Find()
 unsigned
 Bitmap::CountClear() const
 {
-    unsigned count = 0;
+    unsigned set = 0;
 
-    for (unsigned i = 0; i < numBits; i++)
-        if (!Test(i))
-            count++;
-    return count;
+    // Bits past `numBits` in the last word are not counted.
+    for (unsigned w = 0; w < numWords; w++) {
+        unsigned word = map[w];
+        if (w == numWords - 1 && numBits % BITS_IN_WORD != 0)
+            word &= (1U << numBits % BITS_IN_WORD) - 1;
+        set += __builtin_popcount(word);
+    }
+    return numBits - set;
+}
+
+unsigned
+Bitmap::NextClear(unsigned from) const
+{
+    for (unsigned w = from / BITS_IN_WORD; w < numWords; w++) {
+        unsigned clear = ~map[w];
+        if (w == from / BITS_IN_WORD)
+            clear &= ~0U << from % BITS_IN_WORD;
+        if (clear != 0) {
+            unsigned i = w * BITS_IN_WORD + __builtin_ctz(clear);
+            return i < numBits ? i : numBits;
+        }
+    }
+    return numBits;
+}
+
+unsigned
+Bitmap::NextSet(unsigned from) const
+{
+    for (unsigned w = from / BITS_IN_WORD; w < numWords; w++) {
+        unsigned set = map[w];
+        if (w == from / BITS_IN_WORD)
+            set &= ~0U << from % BITS_IN_WORD;
+        if (set != 0) {
+            unsigned i = w * BITS_IN_WORD + __builtin_ctz(set);
+            return i < numBits ? i : numBits;
+        }
+    }
+    return numBits;
 }
 
 /// Print the contents of the bitmap, for debugging.
@@ -3,7 +3,9 @@
 /// vector.
 ///
 /// The bitmap is represented as an array of unsigned integers, on which we
-/// do modulo arithmetic to find the bit we are interested in.
+/// do modulo arithmetic to find the bit we are interested in.  Searches go
+/// a whole word at a time, using the bit scanning and counting built-ins of
+/// the compiler.
 ///
 /// The data structure is parameterized with with the number of bits being
 /// managed.
@@ -61,6 +63,12 @@ public:
     /// If no bits are clear, return -1.
     int Find();
 
+    /// Return the index of the first of `count` consecutive clear bits, and
+    /// as a side effect, set them all.
+    ///
+    /// If there is no such run of bits, return -1.
+    int FindRun(unsigned count);
+
     /// Return the number of clear bits.
     unsigned CountClear() const;
 
@@ -91,6 +99,14 @@ private:
     /// Bit storage.
     unsigned *map;
 
+    /// Return the index of the first clear bit from `from` on, or `numBits`
+    /// if there is none.
+    unsigned NextClear(unsigned from) const;
+
+    /// Return the index of the first set bit from `from` on, or `numBits`
+    /// if there is none.
+    unsigned NextSet(unsigned from) const;
+
 };
 
 
@@ -3,6 +3,10 @@
 /// As in LISP, a list can contain any type of data structure as an item on
 /// the list: thread control blocks, pending interrupts, etc.
 ///
+/// Elements taken off a list are kept by it for later use, so a list that
+/// stays about the same size, like the queue of a semaphore, stops
+/// allocating memory after a while.
+///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2018 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
@@ -28,11 +32,13 @@ public:
     ListElement(Item itemPtr, int sortKey);
 
     ListElement *next;  ///< Next element on list, null if this is the last.
+    ListElement *prev;  ///< Previous element on list, null if this is the
+                        ///< first.
     int key;            ///< Priority, for a sorted list.
     Item item;          ///< Item on the list.
 };
 
-/// The following class defines a “list” -- a singly linked list of list
+/// The following class defines a “list” -- a doubly linked list of list
 /// elements, each of which points to a single item on the list.
 ///
 /// By using the `Sorted` functions, the list can be kept in sorted in
@@ -56,6 +62,7 @@ public:
     /// Take item off the front of the list.
     Item Pop();
 
+    /// Take the first occurrence of `item` off the list, if any.
     void Remove(Item item);
 
     /// Apply `func` to all elements in list.
@@ -66,8 +73,9 @@ public:
 
     /// Is the list empty?
     bool IsEmpty() const;
-    
-    unsigned Length();
+
+    /// How many items are on the list?
+    unsigned Length() const;
 
     /// Routines to put/get items on/off list in order (sorted by key).
 
@@ -83,6 +91,18 @@ private:
 
     ListNode *first;  ///< Head of the list, null if list is empty.
     ListNode *last;   ///< Last element of list.
+    ListNode *spare;  ///< Elements no longer in use, linked by `next`.
+    unsigned count;   ///< Number of items on the list.
+
+    /// Get an element for `item`, reusing a spare one if possible.
+    ListNode *NewNode(Item item, int sortKey);
+
+    /// Put `element` between `before` and `after`, either of which may be
+    /// null at the ends of the list.
+    void Link(ListNode *element, ListNode *before, ListNode *after);
+
+    /// Take `element` off the list, and keep it as a spare.
+    void Unlink(ListNode *element);
 };
 
 /// Initialize a list element, so it can be added somewhere on a list.
@@ -95,6 +115,7 @@ ListElement<Item>::ListElement(Item anItem, int sortKey)
      item = anItem;
      key  = sortKey;
      next = nullptr;  // Assume we will put it at the end of the list.
+     prev = nullptr;
 }
 
 /// Initialize a list, empty to start with.
@@ -103,16 +124,17 @@ ListElement<Item>::ListElement(Item anItem, int sortKey)
 template <class Item>
 List<Item>::List()
 {
-    first = last = nullptr;
+    first = last = spare = nullptr;
+    count = 0;
 }
 
 /// Prepare a list for deallocation.
 ///
-/// If the list still contains any `ListElement`s, de-allocate them.
-/// However, note that we do *not* de-allocate the “items” on the list --
-/// this module allocates and de-allocates the `ListElement`s to keep track
-/// of each item, but a given item may be on multiple lists, so we cannot
-/// de-allocate them here.
+/// If the list still contains any `ListElement`s, de-allocate them, along
+/// with the spare ones.  However, note that we do *not* de-allocate the
+/// “items” on the list -- this module allocates and de-allocates the
+/// `ListElement`s to keep track of each item, but a given item may be on
+/// multiple lists, so we cannot de-allocate them here.
 template <class Item>
 List<Item>::~List()
 {
@@ -120,34 +142,80 @@ List<Item>::~List()
     while (!IsEmpty()) {
         Pop();
     }
+    while (spare != nullptr) {
+        ListNode *element = spare;
+        spare = element->next;
+        delete element;
+    }
+}
+
+template <class Item>
+ListElement<Item> *
+List<Item>::NewNode(Item item, int sortKey)
+{
+    if (spare == nullptr)
+        return new ListNode(item, sortKey);
+
+    ListNode *element = spare;
+    spare = element->next;
+    element->item = item;
+    element->key  = sortKey;
+    return element;
+}
+
+template <class Item>
+void
+List<Item>::Link(ListNode *element, ListNode *before, ListNode *after)
+{
+    element->prev = before;
+    element->next = after;
+    if (before != nullptr)
+        before->next = element;
+    else
+        first = element;
+    if (after != nullptr)
+        after->prev = element;
+    else
+        last = element;
+    count++;
+}
+
+template <class Item>
+void
+List<Item>::Unlink(ListNode *element)
+{
+    if (element->prev != nullptr)
+        element->prev->next = element->next;
+    else
+        first = element->next;
+    if (element->next != nullptr)
+        element->next->prev = element->prev;
+    else
+        last = element->prev;
+    count--;
+
+    element->item = Item();
+    element->next = spare;
+    spare = element;
 }
 
 // Append an “item” to the end of the list.
 //
-// Allocate a `ListElement` to keep track of the item.  If the list is empty,
-// then this will be the only element.  Otherwise, put it at the end.
+// Get a `ListElement` to keep track of the item, and put it after the last
+// one, if any.
 //
 // * `item` is the thing to put on the list, it can be a pointer to anything.
 template <class Item>
 void
 List<Item>::Append(Item item)
 {
-    ListNode *element = new ListNode(item, 0);
-
-    if (IsEmpty()) {
-        first = element;
-        last = element;
-    } else {  // Put it after last.
-        last->next = element;
-        last = element;
-    }
+    Link(NewNode(item, 0), last, nullptr);
 }
 
 /// Put an "item" on the front of the list.
 ///
-/// Allocate a `ListElement` to keep track of the item.  If the list is
-/// empty, then this will be the only element.  Otherwise, put it at the
-/// beginning.
+/// Get a `ListElement` to keep track of the item, and put it before the
+/// first one, if any.
 ///
 /// * `item` is the thing to put on the list, it can be a pointer to
 ///   anything.
@@ -155,15 +223,7 @@ template <class Item>
 void
 List<Item>::Prepend(Item item)
 {
-    ListNode *element = new ListNode(item, 0);
-
-    if (IsEmpty()) {
-        first = element;
-        last = element;
-    } else {  // Put it before first.
-        element->next = first;
-        first = element;
-    }
+    Link(NewNode(item, 0), nullptr, first);
 }
 
 /// Remove the first `item` from the front of the list.
@@ -177,24 +237,15 @@ List<Item>::Pop()
     return SortedPop(nullptr);
 }
 
+/// Finding `item` takes a walk through the list, but taking it off once
+/// found does not.
 template <class Item>
 void
 List<Item>::Remove(Item item)
 {
-    for (ListNode *ptr = first, *prev_ptr = nullptr;
-         ptr != nullptr;
-         prev_ptr = ptr, ptr = ptr->next) {
+    for (ListNode *ptr = first; ptr != nullptr; ptr = ptr->next) {
         if (item == ptr->item) {
-            if (prev_ptr) {
-                prev_ptr->next = ptr->next;
-            }
-            if (first == ptr) {
-                first = ptr->next;
-            }
-            if (last == ptr) {
-                last = prev_ptr;
-            }
-            delete ptr;
+            Unlink(ptr);
             return;
         }
     }
@@ -238,9 +289,9 @@ List<Item>::IsEmpty() const
 /// Insert an `item` into a list, so that the list elements are sorted in
 /// increasing order by `sortKey`.
 ///
-/// Allocate a `ListElement` to keep track of the item.  If the list is
-/// empty, then this will be the only element.  Otherwise, walk through the
-/// list, one element at a time, to find where the new item should be placed.
+/// Get a `ListElement` to keep track of the item, and walk back from the
+/// end of the list to find where the new item should be placed: after any
+/// other item with the same key.
 ///
 /// * `item` is the thing to put on the list, it can be a pointer to
 ///   anything.
@@ -249,26 +300,12 @@ template <class Item>
 void
 List<Item>::SortedInsert(Item item, int sortKey)
 {
-    ListNode *element = new ListNode(item, sortKey);
+    ListNode *before = last;
+    while (before != nullptr && sortKey < before->key)
+        before = before->prev;
 
-    if (IsEmpty()) {  // If list is empty, put.
-        first = element;
-        last = element;
-    } else if (sortKey < first->key) {
-        // Item goes on front of list.
-        element->next = first;
-        first = element;
-    } else {  // Look for first elt in list bigger than item.
-        for (ListNode *ptr = first; ptr->next != nullptr; ptr = ptr->next) {
-            if (sortKey < ptr->next->key) {
-                element->next = ptr->next;
-                ptr->next = element;
-                return;
-            }
-        }
-        last->next = element;  // Item goes at end of list.
-        last = element;
-    }
+    Link(NewNode(item, sortKey), before,
+         before != nullptr ? before->next : first);
 }
 
 /// Remove the first “item” from the front of a sorted list.
@@ -284,38 +321,21 @@ template <class Item>
 Item
 List<Item>::SortedPop(int *keyPtr)
 {
-    ListNode *element = first;
-
     if (IsEmpty())
         return Item();
 
     Item thing = first->item;
-    if (first == last) {  // List had one item, now has none.
-        first = nullptr;
-        last = nullptr;
-    } else {
-        first = element->next;
-    }
     if (keyPtr != nullptr)
-        *keyPtr = element->key;
-    delete element;
+        *keyPtr = first->key;
+    Unlink(first);
     return thing;
 }
 
 template <class Item>
 unsigned
-List<Item>::Length()
+List<Item>::Length() const
 {
-    if (IsEmpty())
-        return 0;
-
-    unsigned total = 0;
-    
-    ListNode *element = first;
-    
-    for(; element != last; element = element -> next, total ++); 
-    
-    return total + 1;
+    return count;
 }
 
 
@@ -1,5 +1,11 @@
 /// A very simple map from non-negative integers to some type.
 ///
+/// The table picks the keys itself.  A key is the index of the slot holding
+/// the item, plus a generation count of the slot in the upper bits, so
+/// looking an item up takes constant time, and a key that was removed is
+/// not mistaken for the next item to take its slot.  Slots are handed out
+/// in increasing order at first, so the first keys are 0, 1, 2...
+///
 /// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
 /// limitation of liability and disclaimer of warranty provisions.
@@ -8,65 +14,126 @@
 #define NACHOS_LIB_TABLE__HH
 
 
-#include "list.hh"
+#include "utility.hh"
 
 
 template <class T>
 class Table {
 public:
-    static const unsigned SIZE = 20;
+    /// Most items a table can hold; it grows up to this as needed.
+    static const unsigned MAX_SIZE = 1 << 16;
 
     Table();
 
+    ~Table();
+
+    /// Store `item`, and return its key, or -1 if the table is full.
     int Add(T item);
 
+    /// Return the item with key `i`, or `T()` if there is none.
     T Get(int i) const;
 
     bool HasKey(int i) const;
 
     bool IsEmpty() const;
 
+    /// Take the item with key `i` out, and return it, or `T()` if there is
+    /// none.
     T Remove(int i);
 
+    /// Return the key of the first item after the one with key `i`, in
+    /// slot order, or -1 if there is none.  `i` may have been removed
+    /// already; -1 starts from the first slot.
+    int NextKey(int i) const;
+
 private:
+    static const unsigned INITIAL_SIZE = 16;
+    static const unsigned INDEX_BITS = 16;
+    static const unsigned GENERATION_MASK = 0x7FFF;  ///< Keeps keys positive.
+
+    struct Slot {
+        T item;
+        unsigned generation;  ///< Times the slot was freed.
+        int nextFree;         ///< Next free slot, if this one is free.
+        bool used;
+    };
+
     /// Data items.
-    T data[SIZE];
+    Slot *slots;
+
+    /// Number of slots, and of those in use.
+    unsigned size;
+    unsigned count;
 
-    /// Current greatest index for a new item.
-    int current;
+    /// First of the free slots, linked through `nextFree`; -1 if none.
+    int firstFree;
 
-    /// A list to store indexes of items that have been freed and are not
-    /// among those with greatest numbers, so it is not possible to modify
-    /// `current`.  In other words, this keeps track of external
-    /// fragmentation.
-    List<int> freed;
+    int KeyOf(unsigned index) const;
+
+    /// Add slots from `from` up to `size` to the free list, in order.
+    void FreeSlots(unsigned from);
 };
 
 
 template <class T>
 Table<T>::Table()
 {
-    current = 0;
+    size      = INITIAL_SIZE;
+    slots     = new Slot [size];
+    count     = 0;
+    firstFree = -1;
+    FreeSlots(0);
 }
 
+template <class T>
+Table<T>::~Table()
+{
+    delete [] slots;
+}
+
+template <class T>
+int
+Table<T>::KeyOf(unsigned index) const
+{
+    return (int) (slots[index].generation << INDEX_BITS | index);
+}
+
+template <class T>
+void
+Table<T>::FreeSlots(unsigned from)
+{
+    for (unsigned i = size; i > from; i--) {
+        slots[i - 1].generation = 0;
+        slots[i - 1].used       = false;
+        slots[i - 1].nextFree   = firstFree;
+        firstFree = i - 1;
+    }
+}
 
 template <class T>
 int
 Table<T>::Add(T item)
 {
-    int i;
-
-    if (!freed.IsEmpty()) {
-        i = freed.Pop();
-        data[i] = item;
-        return i;
-    } else if (current < static_cast<int>(SIZE)) {
-        i = current++;
-        data[i] = item;
-        return i;
-    } else {
-        return -1;
+    if (firstFree == -1) {
+        if (size == MAX_SIZE)
+            return -1;
+
+        // Grow by doubling.
+        Slot *old = slots;
+        slots = new Slot [size * 2];
+        for (unsigned i = 0; i < size; i++)
+            slots[i] = old[i];
+        delete [] old;
+        size *= 2;
+        FreeSlots(size / 2);
     }
+
+    unsigned i = firstFree;
+    firstFree = slots[i].nextFree;
+    slots[i].item = item;
+    slots[i].used = true;
+    count++;
+    return KeyOf(i);
 }
 
 template <class T>
@@ -75,11 +142,11 @@ Table<T>::Get(int i) const
 {
     ASSERT(i >= 0);
 
-    if (freed.Has(i) || i >= current) {
+    if (!HasKey(i)) {
         return T();
     }
 
-    return data[i];
+    return slots[i & (MAX_SIZE - 1)].item;
 }
 
 template <class T>
@@ -88,14 +155,15 @@ Table<T>::HasKey(int i) const
 {
     ASSERT(i >= 0);
 
-    return !(freed.Has(i) || i >= current);
+    unsigned index = i & (MAX_SIZE - 1);
+    return index < size && slots[index].used && KeyOf(index) == i;
 }
 
 template <class T>
 bool
 Table<T>::IsEmpty() const
 {
-    return current == 0;
+    return count == 0;
 }
 
 template <class T>
@@ -108,17 +176,29 @@ Table<T>::Remove(int i)
         return T();
     }
 
-    if (i == current - 1) {
-        current--;
-        for (int j = current - 1; j >= 0 && !HasKey(j); j--) {
-            ASSERT(freed.Has(j));
-            freed.SortedPop(&j);
-            current--;
-        }
-    } else {
-        freed.SortedInsert(i, i);
-    }
-    return data[i];
+    unsigned index = i & (MAX_SIZE - 1);
+    T item = slots[index].item;
+    slots[index].item       = T();
+    slots[index].used       = false;
+    slots[index].generation = (slots[index].generation + 1)
+                              & GENERATION_MASK;
+    slots[index].nextFree   = firstFree;
+    firstFree = index;
+    count--;
+    return item;
+}
+
+template <class T>
+int
+Table<T>::NextKey(int i) const
+{
+    ASSERT(i >= -1);
+
+    unsigned index = i == -1 ? 0 : (i & (MAX_SIZE - 1)) + 1;
+    for (; index < size; index++)
+        if (slots[index].used)
+            return KeyOf(index);
+    return -1;
 }
 
 
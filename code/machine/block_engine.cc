@@ -0,0 +1,436 @@
+/// Basic-block threaded-code engine for the MIPS simulator.
+///
+/// The handlers below replicate `Machine::ExecInstruction` for the most
+/// frequent operations; everything else falls back to it, so both engines
+/// always agree on the effects of every instruction.
+
+
+#include "block_engine.hh"
+#include "machine.hh"
+#include "threads/system.hh"
+
+
+/// Not an operation code: selects the handler that falls back to
+/// `Machine::ExecInstruction`.
+static const unsigned char GENERIC_OP = 0;
+
+BlockEngine::BlockEngine(Machine *m)
+{
+    ASSERT(m != nullptr);
+
+    machine = m;
+    unchargedTicks = 0;
+    numTraps = 0;
+    for (unsigned i = 0; i < MEMORY_SIZE / 4; i++)
+        blocks[i] = nullptr;
+}
+
+BlockEngine::~BlockEngine()
+{
+    for (unsigned i = 0; i < MEMORY_SIZE / 4; i++)
+        delete blocks[i];
+}
+
+/// Simulate the execution of a user-level program, one basic block at a
+/// time.
+///
+/// Like `Machine::Run`, this is re-entrant: no state is kept across blocks,
+/// and each one starts from the program counter, so the engine simply picks
+/// up the right block again after a branch, an exception or a context
+/// switch.
+///
+/// A block is left early when an instruction raised an exception or did not
+/// hand over to the next one (the block started at the delay slot of a
+/// branch), when it overwrote code of its own page, or when its tick is the
+/// last one that can be charged before an interrupt is due.  Its length and
+/// version are read before running it, since they may change when the block
+/// is retranslated.
+void
+BlockEngine::Run()
+{
+    int *registers = machine->registers;
+
+    for (;;) {
+        unsigned pc = registers[PC_REG];
+        unsigned physAddr;
+
+        stats->numMemoryReads++;
+        ExceptionType e = machine->mmu.TranslateFetch(pc, &physAddr);
+        if (e != NO_EXCEPTION) {
+            machine->RaiseException(e, pc);
+            unchargedTicks++;
+        } else {
+            const Block *block = GetBlock(physAddr);
+            unsigned frame = physAddr / PAGE_SIZE;
+            unsigned length = block->length;
+            unsigned version = block->version;
+            unsigned budget = machine->singleStepper != nullptr
+                              ? 1 : interrupt->TicksBeforeDue();
+
+            unsigned long long traps = numTraps;
+            for (unsigned next = 0; ; ) {
+                const Op *op = &block->ops[next];
+                if (next > 0) {
+                    stats->numMemoryReads++;
+                    machine->mmu.RepeatFetch();
+                }
+                if (debug.IsEnabled('m'))
+                    machine->TraceInstruction(&op->instr);
+                op->handler(machine, &op->instr);
+                unchargedTicks++;
+                next++;
+
+                if (numTraps != traps || next == length || next == budget
+                      || (unsigned) registers[PC_REG] != pc + next * 4
+                      || version != machine->mmu.GetCodeVersion(frame))
+                    break;
+            }
+        }
+
+        ChargeTicks();
+        if (machine->singleStepper != nullptr
+              && !machine->singleStepper->Step())
+            machine->singleStepper = nullptr;
+    }
+}
+
+void
+BlockEngine::EnterKernel()
+{
+    ChargeTicks();
+    numTraps++;
+}
+
+void
+BlockEngine::ChargeTicks()
+{
+    if (unchargedTicks == 0)
+        return;
+
+    // Clear the count first: `OneTick` may switch to another thread, which
+    // runs its own blocks.
+    unsigned ticks = unchargedTicks;
+    unchargedTicks = 0;
+    interrupt->OneTick(ticks);
+}
+
+BlockEngine::Block *
+BlockEngine::GetBlock(unsigned physAddr)
+{
+    Block *block = blocks[physAddr / 4];
+    if (block == nullptr) {
+        block = new Block;
+        block->length = 0;
+        blocks[physAddr / 4] = block;
+    }
+
+    if (block->length == 0
+          || block->version
+               != machine->mmu.GetCodeVersion(physAddr / PAGE_SIZE))
+        Translate(block, physAddr);
+    return block;
+}
+
+void
+BlockEngine::Translate(Block *block, unsigned physAddr)
+{
+    ASSERT(block != nullptr);
+
+    unsigned frame = physAddr / PAGE_SIZE;
+    unsigned end = (frame + 1) * PAGE_SIZE;
+    bool delaySlot = false;
+
+    block->start = physAddr;
+    block->length = 0;
+    for (unsigned addr = physAddr; addr < end; addr += 4) {
+        Op *op = &block->ops[block->length++];
+        op->instr = *machine->mmu.GetDecoded(addr);
+        op->handler = HandlerFor(&op->instr);
+
+        if (delaySlot || IsTrap(&op->instr))
+            break;
+        delaySlot = IsBranch(&op->instr);
+    }
+
+    // Decoding may not change the version, but read it afterwards anyway so
+    // that the block is never stamped newer than its contents.
+    block->version = machine->mmu.GetCodeVersion(frame);
+}
+
+bool
+BlockEngine::IsBranch(const Instruction *instr)
+{
+    switch (instr->opCode) {
+        case OP_BEQ:
+        case OP_BGEZ:
+        case OP_BGEZAL:
+        case OP_BGTZ:
+        case OP_BLEZ:
+        case OP_BLTZ:
+        case OP_BLTZAL:
+        case OP_BNE:
+        case OP_J:
+        case OP_JAL:
+        case OP_JALR:
+        case OP_JR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool
+BlockEngine::IsTrap(const Instruction *instr)
+{
+    return instr->opCode == OP_SYSCALL || instr->opCode == OP_RES
+           || instr->opCode == OP_UNIMP;
+}
+
+BlockEngine::Handler
+BlockEngine::HandlerFor(const Instruction *instr)
+{
+    switch (instr->opCode) {
+        case OP_ADDIU: return &Exec<OP_ADDIU>;
+        case OP_ADDU:  return &Exec<OP_ADDU>;
+        case OP_AND:   return &Exec<OP_AND>;
+        case OP_ANDI:  return &Exec<OP_ANDI>;
+        case OP_BEQ:   return &Exec<OP_BEQ>;
+        case OP_BGTZ:  return &Exec<OP_BGTZ>;
+        case OP_BLEZ:  return &Exec<OP_BLEZ>;
+        case OP_BNE:   return &Exec<OP_BNE>;
+        case OP_J:     return &Exec<OP_J>;
+        case OP_JAL:   return &Exec<OP_JAL>;
+        case OP_JALR:  return &Exec<OP_JALR>;
+        case OP_JR:    return &Exec<OP_JR>;
+        case OP_LB:    return &Exec<OP_LB>;
+        case OP_LBU:   return &Exec<OP_LBU>;
+        case OP_LUI:   return &Exec<OP_LUI>;
+        case OP_LW:    return &Exec<OP_LW>;
+        case OP_MFHI:  return &Exec<OP_MFHI>;
+        case OP_MFLO:  return &Exec<OP_MFLO>;
+        case OP_NOR:   return &Exec<OP_NOR>;
+        case OP_OR:    return &Exec<OP_OR>;
+        case OP_ORI:   return &Exec<OP_ORI>;
+        case OP_SB:    return &Exec<OP_SB>;
+        case OP_SLL:   return &Exec<OP_SLL>;
+        case OP_SLLV:  return &Exec<OP_SLLV>;
+        case OP_SLT:   return &Exec<OP_SLT>;
+        case OP_SLTI:  return &Exec<OP_SLTI>;
+        case OP_SLTIU: return &Exec<OP_SLTIU>;
+        case OP_SLTU:  return &Exec<OP_SLTU>;
+        case OP_SRA:   return &Exec<OP_SRA>;
+        case OP_SRAV:  return &Exec<OP_SRAV>;
+        case OP_SUBU:  return &Exec<OP_SUBU>;
+        case OP_SW:    return &Exec<OP_SW>;
+        case OP_XOR:   return &Exec<OP_XOR>;
+        case OP_XORI:  return &Exec<OP_XORI>;
+        default:       return &Exec<GENERIC_OP>;
+    }
+}
+
+/// Execute one instruction.
+///
+/// `OP` is a compile time constant, so the `switch` below reduces to a
+/// single case in every instantiation.  The code of each case, including
+/// the delayed load and program counter updates at the end, mirrors
+/// `Machine::ExecInstruction`.
+template <unsigned char OP>
+void
+BlockEngine::Exec(Machine *m, const Instruction *instr)
+{
+    int *registers = m->registers;
+    int nextLoadReg = 0;
+    int nextLoadValue = 0;
+    int pcAfter = registers[NEXT_PC_REG] + 4;
+    int tmp, value;
+
+    switch (OP) {
+        case OP_ADDIU:
+            registers[instr->rt] = registers[instr->rs] + instr->extra;
+            break;
+
+        case OP_ADDU:
+            registers[instr->rd] = registers[instr->rs]
+                                   + registers[instr->rt];
+            break;
+
+        case OP_AND:
+            registers[instr->rd] = registers[instr->rs]
+                                   & registers[instr->rt];
+            break;
+
+        case OP_ANDI:
+            registers[instr->rt] = registers[instr->rs]
+                                   & (instr->extra & 0xFFFF);
+            break;
+
+        case OP_BEQ:
+            if (registers[instr->rs] == registers[instr->rt])
+                pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+            break;
+
+        case OP_BGTZ:
+            if (registers[instr->rs] > 0)
+                pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+            break;
+
+        case OP_BLEZ:
+            if (registers[instr->rs] <= 0)
+                pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+            break;
+
+        case OP_BNE:
+            if (registers[instr->rs] != registers[instr->rt])
+                pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+            break;
+
+        case OP_JAL:
+            registers[RET_ADDR_REG] = registers[NEXT_PC_REG] + 4;
+            pcAfter = (pcAfter & 0xF0000000) | IndexToAddr(instr->extra);
+            break;
+
+        case OP_J:
+            pcAfter = (pcAfter & 0xF0000000) | IndexToAddr(instr->extra);
+            break;
+
+        case OP_JALR:
+            registers[instr->rd] = registers[NEXT_PC_REG] + 4;
+            pcAfter = registers[instr->rs];
+            break;
+
+        case OP_JR:
+            pcAfter = registers[instr->rs];
+            break;
+
+        case OP_LB:
+        case OP_LBU:
+            tmp = registers[instr->rs] + instr->extra;
+            if (!m->ReadMem(tmp, 1, &value))
+                return;
+
+            if (value & 0x80 && OP == OP_LB)
+                value |= 0xFFFFFF00;
+            else
+                value &= 0xFF;
+            nextLoadReg = instr->rt;
+            nextLoadValue = value;
+            break;
+
+        case OP_LUI:
+            DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+            registers[instr->rt] = instr->extra << 16;
+            break;
+
+        case OP_LW:
+            tmp = registers[instr->rs] + instr->extra;
+            if (tmp & 0x3) {
+                m->RaiseException(ADDRESS_ERROR_EXCEPTION, tmp);
+                return;
+            }
+            if (!m->ReadMem(tmp, 4, &value))
+                return;
+            nextLoadReg = instr->rt;
+            nextLoadValue = value;
+            break;
+
+        case OP_MFHI:
+            registers[instr->rd] = registers[HI_REG];
+            break;
+
+        case OP_MFLO:
+            registers[instr->rd] = registers[LO_REG];
+            break;
+
+        case OP_NOR:
+            registers[instr->rd] = ~(registers[instr->rs]
+                                     | registers[instr->rt]);
+            break;
+
+        case OP_OR:
+            registers[instr->rd] = registers[instr->rs]
+                                   | registers[instr->rt];
+            break;
+
+        case OP_ORI:
+            registers[instr->rt] = registers[instr->rs]
+                                   | (instr->extra & 0xFFFF);
+            break;
+
+        case OP_SB:
+            if (!m->WriteMem((unsigned) (registers[instr->rs] + instr->extra),
+                             1, registers[instr->rt]))
+                return;
+            break;
+
+        case OP_SLL:
+            registers[instr->rd] = registers[instr->rt] << instr->extra;
+            break;
+
+        case OP_SLLV:
+            registers[instr->rd] = registers[instr->rt]
+                                   << (registers[instr->rs] & 0x1F);
+            break;
+
+        case OP_SLT:
+            registers[instr->rd] =
+              registers[instr->rs] < registers[instr->rt] ? 1 : 0;
+            break;
+
+        case OP_SLTI:
+            registers[instr->rt] = registers[instr->rs] < instr->extra ? 1 : 0;
+            break;
+
+        case OP_SLTIU:
+            registers[instr->rt] =
+              (unsigned) registers[instr->rs] < (unsigned) instr->extra ? 1 : 0;
+            break;
+
+        case OP_SLTU:
+            registers[instr->rd] =
+              (unsigned) registers[instr->rs] < (unsigned) registers[instr->rt]
+              ? 1 : 0;
+            break;
+
+        case OP_SRA:
+            registers[instr->rd] = registers[instr->rt] >> instr->extra;
+            break;
+
+        case OP_SRAV:
+            registers[instr->rd] = registers[instr->rt]
+                                   >> (registers[instr->rs] & 0x1F);
+            break;
+
+        case OP_SUBU:
+            registers[instr->rd] = registers[instr->rs]
+                                   - registers[instr->rt];
+            break;
+
+        case OP_SW:
+            if (!m->WriteMem((unsigned) (registers[instr->rs] + instr->extra),
+                             4, registers[instr->rt]))
+                return;
+            break;
+
+        case OP_XOR:
+            registers[instr->rd] = registers[instr->rs]
+                                   ^ registers[instr->rt];
+            break;
+
+        case OP_XORI:
+            registers[instr->rt] = registers[instr->rs]
+                                   ^ (instr->extra & 0xFFFF);
+            break;
+
+        default:
+            m->ExecInstruction(instr);
+            return;
+    }
+
+    // Do any delayed load operation.
+    m->DelayedLoad(nextLoadReg, nextLoadValue);
+
+    // Advance program counters.
+    registers[PREV_PC_REG] = registers[PC_REG];
+    registers[PC_REG] = registers[NEXT_PC_REG];
+    registers[NEXT_PC_REG] = pcAfter;
+}
@@ -0,0 +1,112 @@
+/// Basic-block threaded-code engine for the MIPS simulator.
+///
+/// Instead of decoding every instruction and dispatching it through the
+/// big `switch` in `Machine::ExecInstruction`, user code is split into
+/// basic blocks: straight-line runs of instructions that end after the
+/// delay slot of a branch or jump, at a system call, or at the end of a
+/// page.  Each block is translated once into threaded code, that is, an
+/// array of handler pointers paired with their decoded operands.
+///
+/// Blocks are indexed by the physical address of their first instruction
+/// and stamped with the MMU code version of their page, so they are
+/// rebuilt whenever the page is reloaded or one of its instructions is
+/// overwritten.
+///
+/// A block is run as a whole.  Only its first instruction is fetched
+/// through the MMU: the rest lie in the same page, whose translation cannot
+/// change without an exception, which ends the block, so they only repeat
+/// the side effects of the fetch.  The ticks of the block are charged at
+/// once, and the block stops early at the instruction where an interrupt
+/// comes due.  TLB misses, page faults, interrupts and statistics thus
+/// behave exactly as in the reference interpreter.
+
+
+#ifndef NACHOS_MACHINE_BLOCKENGINE__HH
+#define NACHOS_MACHINE_BLOCKENGINE__HH
+
+
+#include "instruction.hh"
+#include "mmu.hh"
+
+
+class Machine;
+
+class BlockEngine {
+public:
+
+    /// Create an engine that executes code on behalf of `m`.
+    BlockEngine(Machine *m);
+
+    ~BlockEngine();
+
+    /// Run user code until the current thread finishes; never returns.
+    void Run();
+
+    /// Called before the kernel handles an exception.  Charges the ticks
+    /// of the instructions run so far in the current block, so that the
+    /// kernel finds the clock where the reference interpreter would leave
+    /// it, and makes the engine leave the block once the handler returns.
+    void EnterKernel();
+
+private:
+
+    /// Execute one instruction, with exactly the same effects as
+    /// `Machine::ExecInstruction`.
+    typedef void (*Handler)(Machine *m, const Instruction *instr);
+
+    struct Op {
+        Handler handler;
+        Instruction instr;
+    };
+
+    struct Block {
+        unsigned start;    ///< Physical address of the first instruction.
+        unsigned version;  ///< Code version of the page when translated.
+        unsigned length;   ///< Number of valid entries in `ops`; zero if
+                           ///< the block was never translated.
+        Op ops[PAGE_SIZE / 4];
+    };
+
+    /// Return the current block starting at physical address `physAddr`,
+    /// translating it if needed.
+    Block *GetBlock(unsigned physAddr);
+
+    /// Fill `block` with the threaded code starting at `physAddr`.
+    void Translate(Block *block, unsigned physAddr);
+
+    /// Handler specialized at compile time for operation `OP`; operations
+    /// without a specialized version go through `Machine::ExecInstruction`.
+    template <unsigned char OP>
+    static void Exec(Machine *m, const Instruction *instr);
+
+    /// Pick the handler for a decoded instruction.
+    static Handler HandlerFor(const Instruction *instr);
+
+    /// Whether `instr` is a branch or a jump, so that the block ends after
+    /// its delay slot.
+    static bool IsBranch(const Instruction *instr);
+
+    /// Whether a basic block ends right after `instr`, which always traps
+    /// to the kernel.
+    static bool IsTrap(const Instruction *instr);
+
+    Machine *machine;
+
+    /// Instructions run whose ticks were not charged yet.
+    unsigned unchargedTicks;
+
+    /// Number of exceptions raised so far.  A block is left when it changes
+    /// while running it: the handler may have blocked, and other threads
+    /// may have reused the frame and retranslated the block meanwhile.
+    unsigned long long numTraps;
+
+    /// Charge the ticks of the instructions run so far.
+    void ChargeTicks();
+
+    /// Translated blocks, indexed by physical word of their first
+    /// instruction.  Allocated lazily and reused when retranslated.
+    Block *blocks[MEMORY_SIZE / 4];
+};
+
+
+#endif
@@ -185,7 +185,7 @@ Disk::TimeToSeek(unsigned newSector, unsigned *rotation)
     unsigned oldTrack = lastSector / SECTORS_PER_TRACK;
     unsigned seek = Diff(newTrack, oldTrack) * SEEK_TIME;
       // How long will seek take?
-    unsigned over = (stats->totalTicks + seek) % ROTATION_TIME;
+    unsigned over = (unsigned) ((stats->totalTicks + seek) % ROTATION_TIME);
       // Will we be in the middle of a sector when we finish the seek?
 
     *rotation = 0;
@@ -197,7 +197,7 @@ Disk::TimeToSeek(unsigned newSector, unsigned *rotation)
 /// Return number of sectors of rotational delay between target sector `to`
 /// and current sector position `from`.
 unsigned
-Disk::ModuloDiff(unsigned to, unsigned from)
+Disk::ModuloDiff(unsigned long long to, unsigned long long from)
 {
     unsigned toOffset   = to % SECTORS_PER_TRACK;
     unsigned fromOffset = from % SECTORS_PER_TRACK;
@@ -226,7 +226,7 @@ Disk::ComputeLatency(unsigned newSector, bool writing)
 {
     unsigned rotation;
     unsigned seek      = TimeToSeek(newSector, &rotation);
-    unsigned timeAfter = stats->totalTicks + seek + rotation;
+    unsigned long long timeAfter = stats->totalTicks + seek + rotation;
 
 #ifndef NOTRACKBUF  // Turn this on if you do not want the track buffer
                     // stuff.
@@ -258,5 +258,5 @@ Disk::UpdateLast(unsigned newSector)
     if (seek != 0)
         bufferInit = stats->totalTicks + seek + rotate;
     lastSector = newSector;
-    DEBUG('d', "Updating last sector = %u, %u\n", lastSector, bufferInit);
+    DEBUG('d', "Updating last sector = %u, %llu\n", lastSector, bufferInit);
 }
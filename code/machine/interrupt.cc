@@ -54,7 +54,7 @@ IsIntType(IntType t)
 /// * `time` is when (in simulated time) the interrupt is to occur.
 /// * `kind` is the hardware device that generated the interrupt.
 PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
-                                   unsigned time, IntType kind)
+                                   unsigned long long time, IntType kind)
 {
     ASSERT(func != nullptr);
     ASSERT(IsIntType(kind));
@@ -63,6 +63,15 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
     arg     = param;
     when    = time;
     type    = kind;
+    order   = 0;
+}
+
+/// Tell whether `a` is to fire before `b`: interrupts due at the same time
+/// fire in the order they were scheduled.
+static inline bool
+Earlier(const PendingInterrupt &a, const PendingInterrupt &b)
+{
+    return a.when < b.when || (a.when == b.when && a.order < b.order);
 }
 
 /// Initialize the simulation of hardware device interrupts.
@@ -71,18 +80,20 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
 Interrupt::Interrupt()
 {
     level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
+    pendingSize   = 16;
+    pending       = new PendingInterrupt [pendingSize];
+    numPending    = 0;
+    numScheduled  = 0;
     inHandler     = false;
     yieldOnReturn = false;
     status        = SYSTEM_MODE;
+    nextDue       = ULLONG_MAX;
 }
 
 /// De-allocate the data structures needed by the interrupt simulation.
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-        delete pending->Pop();
-    delete pending;
+    delete [] pending;
 }
 
 /// Change interrupts to be enabled or disabled, without advancing the
@@ -140,20 +151,32 @@ Interrupt::Enable()
 /// Two things can cause `OneTick` to be called:
 /// * interrupts are re-enabled;
 /// * a user instruction is executed.
+///
+/// Most ticks have nothing to fire: as long as the clock stays before
+/// `nextDue` and no context switch was requested, only the clock advances.
+///
+/// * `count` is the number of ticks to advance.
 void
-Interrupt::OneTick()
+Interrupt::OneTick(unsigned count)
 {
     MachineStatus old = status;
 
     // Advance simulated time.
     if (status == SYSTEM_MODE) {
-        stats->totalTicks += SYSTEM_TICK;
-    stats->systemTicks += SYSTEM_TICK;
+        stats->totalTicks += SYSTEM_TICK * count;
+    stats->systemTicks += SYSTEM_TICK * count;
     } else {  // USER_PROGRAM
-    stats->totalTicks += USER_TICK;
-    stats->userTicks += USER_TICK;
+    stats->totalTicks += USER_TICK * count;
+    stats->userTicks += USER_TICK * count;
     }
-    DEBUG('i', "== Tick %u ==\n", stats->totalTicks);
+
+    if (stats->totalTicks < nextDue && !yieldOnReturn
+          && !debug.IsEnabled('i')) {
+        level = INT_ON;  // Where the slow path below leaves it.
+        return;
+    }
+
+    DEBUG('i', "== Tick %llu ==\n", stats->totalTicks);
 
     // Check any pending interrupts are now ready to fire.
     ChangeLevel(INT_ON, INT_OFF);  // First, turn off interrupts (interrupt
@@ -170,6 +193,23 @@ Interrupt::OneTick()
     }
 }
 
+/// Return how many user instructions can run, at least one, before
+/// something may have to happen after one of them.
+///
+/// `OneTick` takes its slow path once the clock reaches `nextDue`, on a
+/// requested context switch, and when tracing interrupts.
+unsigned
+Interrupt::TicksBeforeDue() const
+{
+    if (yieldOnReturn || debug.IsEnabled('i')
+          || stats->totalTicks + USER_TICK >= nextDue)
+        return 1;
+
+    unsigned long long ticks
+      = (nextDue - stats->totalTicks + USER_TICK - 1) / USER_TICK;
+    return ticks < UINT_MAX ? (unsigned) ticks : UINT_MAX;
+}
+
 /// Called from within an interrupt handler, to cause a context switch (for
 /// example, on a time slice) in the interrupted thread, when the handler
 /// returns.
@@ -225,39 +265,10 @@ Interrupt::Halt()
     Cleanup();  // Never returns.
 }
 
-#ifdef DFS_TICKS_FIX
-/// Restart the total ticks statistic and the pending interrupts list.
-///
-/// This function makes sure Nachos keeps working even after overflowing the
-/// tick counter.  After some time (when `totalTicks` reach the maximum
-/// positive number) Nachos would schedule a pending interrupt at a negative
-/// time, and after that, it would hang.
-void
-Interrupt::RestartTicks()
-{
-    List<PendingInterrupt *> *oldPending = pending;
-    pending = new List<PendingInterrupt *>;
-
-    PendingInterrupt *i;
-    unsigned          oldWhen = 0;
-    while ((i = oldPending->SortedPop((int *) &oldWhen)) != nullptr)
-    {
-        unsigned newWhen = oldWhen - stats->totalTicks;
-        pending->SortedInsert(i, newWhen);
-        DEBUG('x', "Interrupt at time %u re-scheduled at new time %u.\n",
-              oldWhen, newWhen);
-    }
-
-    delete oldPending;
-    stats->totalTicks = 0;
-    stats->tickResets += 1;
-}
-#endif
-
 /// Arrange for the CPU to be interrupted when simulated time reaches `now +
 /// when`.
 ///
-/// Implementation: just put it on a sorted list.
+/// Implementation: just put it on a heap.
 ///
 /// NOTE: the Nachos kernel should not call this routine directly.  Instead,
 /// it is only called by the hardware device simulators.
@@ -275,26 +286,70 @@ Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
     ASSERT(fromNow > 0);
     ASSERT(IsIntType(type));
 
-#ifdef DFS_TICKS_FIX
-    if (UINT_MAX - stats->totalTicks < fromNow)
-    {
-        DEBUG('x', "WARNING: total tick count is too large"
-                   " and will be reset.\n");
-        RestartTicks();
+    unsigned long long when = stats->totalTicks + fromNow;
+
+    DEBUG('i', "Scheduling interrupt handler the %s at time = %llu\n",
+          INT_TYPE_NAMES[type], when);
+
+    if (numPending == pendingSize) {
+        PendingInterrupt *old = pending;
+        pending = new PendingInterrupt [pendingSize * 2];
+        for (unsigned i = 0; i < numPending; i++)
+            pending[i] = old[i];
+        pendingSize *= 2;
+        delete [] old;
     }
-#else
-    // Terminate Nachos if the ticks overflowed.
-    ASSERT(UINT_MAX - stats->totalTicks > fromNow);
-#endif
 
-    unsigned when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg,
-                                                     when, type);
+    pending[numPending] = PendingInterrupt(handler, arg, when, type);
+    pending[numPending].order = numScheduled++;
+    SiftUp(numPending++);
+    UpdateNextDue();
+}
 
-    DEBUG('i', "Scheduling interrupt handler the %s at time = %u\n",
-          INT_TYPE_NAMES[type], when);
+void
+Interrupt::PopPending()
+{
+    ASSERT(numPending > 0);
 
-    pending->SortedInsert(toOccur, when);
+    pending[0] = pending[--numPending];
+    if (numPending > 0)
+        SiftDown(0);
+}
+
+void
+Interrupt::SiftUp(unsigned i)
+{
+    PendingInterrupt moved = pending[i];
+    while (i > 0 && Earlier(moved, pending[(i - 1) / 2])) {
+        pending[i] = pending[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    pending[i] = moved;
+}
+
+void
+Interrupt::SiftDown(unsigned i)
+{
+    PendingInterrupt moved = pending[i];
+    for (;;) {
+        unsigned child = 2 * i + 1;
+        if (child >= numPending)
+            break;
+        if (child + 1 < numPending && Earlier(pending[child + 1],
+                                              pending[child]))
+            child++;
+        if (!Earlier(pending[child], moved))
+            break;
+        pending[i] = pending[child];
+        i = child;
+    }
+    pending[i] = moved;
+}
+
+void
+Interrupt::UpdateNextDue()
+{
+    nextDue = numPending > 0 ? pending[0].when : ULLONG_MAX;
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -309,34 +364,38 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    unsigned      when;
 
     ASSERT(level == INT_OFF);  // Interrupts need to be disabled, to invoke
                                // an interrupt handler.
     if (debug.IsEnabled('i'))
         DumpState();
-    PendingInterrupt *toOccur = pending->SortedPop((int *) &when);
 
-    if (toOccur == nullptr)  // No pending interrupts.
-    return false;
+    if (numPending == 0)  // No pending interrupts.
+        return false;
+
+    // Look at the first interrupt due, leaving it in place unless it fires.
+    unsigned long long when = pending[0].when;
+    if (when > stats->totalTicks && !advanceClock)  // Not time yet.
+        return false;
 
-    if (advanceClock && when > stats->totalTicks) {  // Advance the clock.
+    if (when > stats->totalTicks) {  // Advance the clock.
         stats->idleTicks += (when - stats->totalTicks);
         stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {  // Not time yet, put it back.
-        pending->SortedInsert(toOccur, when);
-        return false;
     }
 
     // Check if there is nothing more to do, and if so, quit.
-    if (status == IDLE_MODE && toOccur->type == TIMER_INT
-          && pending->IsEmpty()) {
-        pending->SortedInsert(toOccur, when);
+    if (status == IDLE_MODE && pending[0].type == TIMER_INT
+          && numPending == 1)
         return false;
-    }
 
-    DEBUG('i', "Invoking interrupt handler for the %s at time %u\n",
-            INT_TYPE_NAMES[toOccur->type], toOccur->when);
+    // The handler may schedule other interrupts, so take this one out of
+    // `pending` first.
+    PendingInterrupt toOccur = pending[0];
+    PopPending();
+    UpdateNextDue();
+
+    DEBUG('i', "Invoking interrupt handler for the %s at time %llu\n",
+            INT_TYPE_NAMES[toOccur.type], toOccur.when);
 #ifdef USER_PROGRAM
     if (machine != nullptr)
         machine->DelayedLoad(0, 0);
@@ -344,10 +403,9 @@ Interrupt::CheckIfDue(bool advanceClock)
     inHandler = true;
     status = SYSTEM_MODE;  // Whatever we were doing, we are now going to be
                            // running in the kernel.
-    (*toOccur->handler)(toOccur->arg);  // Call the interrupt handler.
+    (*toOccur.handler)(toOccur.arg);  // Call the interrupt handler.
     status = old;  // Restore the machine status.
     inHandler = false;
-    delete toOccur;
     return true;
 }
 
@@ -372,11 +430,11 @@ Interrupt::SetStatus(MachineStatus st)
 /// Print information about an interrupt that is scheduled to occur.  When,
 /// where, why, etc.
 static void
-PrintPending(PendingInterrupt *pend)
+PrintPending(const PendingInterrupt *pend)
 {
     ASSERT(pend != nullptr);
 
-    printf("    Handler %s, scheduled at %u\n",
+    printf("    Handler %s, scheduled at %llu\n",
            INT_TYPE_NAMES[pend->type], pend->when);
 }
 
@@ -385,12 +443,14 @@ PrintPending(PendingInterrupt *pend)
 void
 Interrupt::DumpState()
 {
-    printf("Time: %u, interrupts %s\n",
+    printf("Time: %llu, interrupts %s\n",
            stats->totalTicks, INT_LEVEL_NAMES[level]);
-    if (pending->IsEmpty())
+    if (numPending == 0)
         printf("No pending interrupts\n");
     else {
+        // In heap order: only the first one is sure to be the next due.
         printf("Pending interrupts:\n");
-        pending->Apply(PrintPending);
+        for (unsigned i = 0; i < numPending; i++)
+            PrintPending(&pending[i]);
     }
 }
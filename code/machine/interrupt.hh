@@ -36,7 +36,7 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
-#include "lib/list.hh"
+#include "lib/utility.hh"
 
 
 /// Interrupts can be disabled (`INT_OFF`) or enabled (`INT_ON`).
@@ -77,16 +77,21 @@ enum IntType {
 class PendingInterrupt {
 public:
 
+    /// Initialize an empty slot of the pending interrupt queue.
+    PendingInterrupt() {}
+
     /// initialize an interrupt that will occur in the future.
     PendingInterrupt(VoidFunctionPtr func, void *param,
-                     unsigned time, IntType kind);
+                     unsigned long long time, IntType kind);
 
     VoidFunctionPtr handler;  ///< The function (in the hardware device
                               ///< emulator) to call when the interrupt
                               ///< occurs.
     void *arg;  ///< The argument to the function.
-    unsigned when;  ///< When the interrupt is supposed to fire.
+    unsigned long long when;  ///< When the interrupt is supposed to fire.
     IntType type;  ///< For debugging.
+    unsigned long long order;  ///< How many interrupts were scheduled
+                               ///< before this one; breaks ties in `when`.
 };
 
 /// The following class defines the data structures for the simulation
@@ -142,18 +147,37 @@ public:
     void Schedule(VoidFunctionPtr handler, void *arg,
                   unsigned when, IntType type);
 
-    /// Advance simulated time.
-    void OneTick();
+    /// Advance simulated time by `count` ticks, checking for interrupts
+    /// only after the last one.  Several ticks may only be charged at once
+    /// if no interrupt comes due before the last; see `TicksBeforeDue`.
+    void OneTick(unsigned count = 1);
+
+    /// Return how many user instructions can run, at least one, before
+    /// something may have to happen after one of them: an interrupt coming
+    /// due, a context switch, or tracing.  Their ticks can then be charged
+    /// with a single `OneTick`.
+    unsigned TicksBeforeDue() const;
 
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
-    List<PendingInterrupt *> *pending;  ///< The list of interrupts scheduled
-                                        ///< to occur in the future.
+    PendingInterrupt *pending;  ///< The interrupts scheduled to occur in the
+                                ///< future, as a binary heap with the first
+                                ///< one due at the root.  Kept by value, so
+                                ///< scheduling an interrupt only allocates
+                                ///< when the array has to grow.
+    unsigned numPending;  ///< Interrupts in `pending`.
+    unsigned pendingSize;  ///< Room in `pending`.
+    unsigned long long numScheduled;  ///< Interrupts scheduled so far.
     bool inHandler;  ///< True if we are running an interrupt handler.
     bool yieldOnReturn;  ///< True if we are to context switch on return from
                          ///< the interrupt handler.
     MachineStatus status;  ///< Idle, kernel mode, user mode.
 
+    unsigned long long nextDue;  ///< When the first pending interrupt is
+                                 ///< due, or `ULLONG_MAX` if there is none.
+                                 ///< Until then, `OneTick` only needs to
+                                 ///< advance the clock.
+
     /// These functions are internal to the interrupt simulation code.
 
     /// Check if an interrupt is supposed to occur now.
@@ -163,10 +187,16 @@ private:
     void ChangeLevel(IntStatus old,
                      IntStatus now);
 
-#ifdef DFS_TICKS_FIX
-    /// Restart total ticks and the pending interrupt list.
-    void RestartTicks();
-#endif
+    /// Remove the first interrupt due from `pending`.
+    void PopPending();
+
+    /// Restore the order of `pending` after the entry at `i` was made
+    /// due earlier or later.
+    void SiftUp(unsigned i);
+    void SiftDown(unsigned i);
+
+    /// Refresh `nextDue` after `pending` changes.
+    void UpdateNextDue();
 
 };
 
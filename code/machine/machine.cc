@@ -9,6 +9,7 @@
 
 
 #include "machine.hh"
+#include "block_engine.hh"
 #include "threads/system.hh"
 
 
@@ -54,9 +55,22 @@ Machine::Machine(SingleStepper *st)
         handlers[i] = nullptr;
 
     singleStepper = st;
+    blockEngine = nullptr;
     CheckEndian();
 }
 
+Machine::~Machine()
+{
+    delete blockEngine;
+}
+
+void
+Machine::EnableBlockEngine()
+{
+    if (blockEngine == nullptr)
+        blockEngine = new BlockEngine(this);
+}
+
 const int *
 Machine::GetRegisters() const
 {
@@ -111,6 +125,20 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
     return true;
 }
 
+bool
+Machine::TranslateRange(unsigned addr, unsigned size, bool writing,
+                        unsigned *physAddr)
+{
+    if (!writing)
+        stats -> numMemoryReads ++;
+    ExceptionType e = mmu.TranslateRange(addr, size, writing, physAddr);
+    if (e != NO_EXCEPTION) {
+        RaiseException(e, addr);
+        return false;
+    }
+    return true;
+}
+
 /// Transfer control to the Nachos kernel from user mode, because the user
 /// program either invoked a system call, or some exception occured (such as
 /// the address translation failed).
@@ -129,6 +157,9 @@ Machine::RaiseException(ExceptionType et, unsigned badVAddr)
     registers[BAD_VADDR_REG] = badVAddr;
     DelayedLoad(0, 0);  // Finish anything in progress.
 
+    if (blockEngine != nullptr)
+        blockEngine->EnterKernel();
+
     // Call the associated handler with interrupts enabled in system mode.
     interrupt->SetStatus(SYSTEM_MODE);
     (*handlers[et])(et);
@@ -48,6 +48,7 @@ enum {
 };
 
 class Instruction;
+class BlockEngine;
 
 typedef void (*ExceptionHandler)(ExceptionType);
 
@@ -70,11 +71,18 @@ public:
     /// Initialize the simulation of the hardware for running user programs.
     Machine(SingleStepper *st);
 
+    /// De-allocate the block engine, if any.
+    ~Machine();
+
     /// Routines callable by the Nachos kernel.
 
     /// Run a user program.
     void Run();
 
+    /// Run user programs with the basic-block threaded-code engine instead
+    /// of the reference interpreter.  Must be called before `Run`.
+    void EnableBlockEngine();
+
     const int *GetRegisters() const;
 
     MMU *GetMMU();
@@ -92,19 +100,25 @@ public:
 
     bool WriteMem(unsigned addr, unsigned size, int value);
 
+    bool TranslateRange(unsigned addr, unsigned size, bool writing,
+                        unsigned *physAddr);
+
     /// Print the user CPU and memory state.
     void DumpState();
 
     /// Routines internal to the machine simulation -- DO NOT call these.
 
-    /// Fetch one instruction of a user program.
+    /// Fetch one instruction of a user program, already decoded.
     ///
     /// Return false if an exception occurs, true otherwise.
-    bool FetchInstruction(Instruction *instr);
+    bool FetchInstruction(const Instruction **instr);
 
     /// Run a certain instruction of a user program.
     void ExecInstruction(const Instruction *instr);
 
+    /// Print an instruction for the `m` debugging flag.
+    void TraceInstruction(const Instruction *instr) const;
+
     /// Do a pending delayed load (modifying a reg).
     void DelayedLoad(unsigned nextReg, int nextVal);
 
@@ -131,6 +145,12 @@ private:
 
     MMU mmu; ///< Memory management unit.
 
+    BlockEngine *blockEngine;  ///< Alternative execution engine, if
+                               ///< enabled.
+
+    /// The block engine executes instructions on our behalf.
+    friend class BlockEngine;
+
     ExceptionHandler handlers[NUM_EXCEPTION_TYPES];  ///< Exception handlers.
 };
 
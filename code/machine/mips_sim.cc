@@ -11,8 +11,10 @@
 /// limitation of liability and disclaimer of warranty provisions.
 
 
+#include "alu.hh"
 #include "instruction.hh"
 #include "machine.hh"
+#include "block_engine.hh"
 #include "threads/system.hh"
 
 
@@ -25,15 +27,18 @@
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;
-      // Storage for decoded instruction.
+    const Instruction *instr;
+      // Decoded instruction, owned by the MMU.
 
     if (debug.IsEnabled('m'))
-        printf("Starting to run at time %u\n", stats->totalTicks);
+        printf("Starting to run at time %llu\n", stats->totalTicks);
     interrupt->SetStatus(USER_MODE);
 
+    if (blockEngine != nullptr)
+        blockEngine->Run();  // Never returns.
+
     for (;;) {
-        if (FetchInstruction(instr))
+        if (FetchInstruction(&instr))
             ExecInstruction(instr);
         interrupt->OneTick();
         if (singleStepper != nullptr && !singleStepper->Step())
@@ -55,93 +60,38 @@ Machine::DelayedLoad(unsigned nextReg, int nextValue)
 }
 
 bool
-Machine::FetchInstruction(Instruction *instr)
+Machine::FetchInstruction(const Instruction **instrPtr)
 {
-    ASSERT(instr != nullptr);
-
-    int raw;
-    if (!ReadMem(registers[PC_REG], 4, &raw))
-        return false;  // Exception occurred.
-    instr->value = raw;
-    instr->Decode();
-
-    if (debug.IsEnabled('m')) {
-        const struct OpString *str = &OP_STRINGS[instr->opCode];
-
-        ASSERT(instr->opCode <= MAX_OPCODE);
-        DEBUG('m', "At PC = 0x%X: ", registers[PC_REG]);
-        DEBUG_CONT('m', str->string, instr->RegFromType(str->args[0]),
-                        instr->RegFromType(str->args[1]),
-                        instr->RegFromType(str->args[2]));
-        DEBUG_CONT('m', "\n");
+    ASSERT(instrPtr != nullptr);
+
+    // An instruction fetch counts as a memory read, whether or not the
+    // decoding was cached.
+    stats -> numMemoryReads ++;
+    ExceptionType e = mmu.FetchInstruction(registers[PC_REG], instrPtr);
+    if (e != NO_EXCEPTION) {
+        RaiseException(e, registers[PC_REG]);
+        return false;
     }
+
+    if (debug.IsEnabled('m'))
+        TraceInstruction(*instrPtr);
     return true;
 }
 
-/// Simulate R2000 multiplication.
-///
-/// The words at `*hiPtr` and `*loPtr` are overwritten with the double-length
-/// result of the multiplication.
-static void
-Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr)
+/// Print the instruction about to be executed, for the `m` debug flag.
+void
+Machine::TraceInstruction(const Instruction *instr) const
 {
-    ASSERT(hiPtr != nullptr);
-    ASSERT(loPtr != nullptr);
-
-    if (a == 0 || b == 0) {
-        *hiPtr = *loPtr = 0;
-        return;
-    }
-
-    // Compute the sign of the result, then make everything positive so
-    // unsigned computation can be done in the main loop.
-    bool negative = false;
-    if (signedArith) {
-        if (a < 0) {
-            negative = !negative;
-            a = -a;
-        }
-        if (b < 0) {
-            negative = !negative;
-            b = -b;
-        }
-    }
-
-    // Compute the result in unsigned arithmetic (check `a`'s bits one at a
-    // time, and add in a shifted value of `b`).
-    unsigned bLo = b;
-    unsigned bHi = 0;
-    unsigned lo = 0;
-    unsigned hi = 0;
-    for (unsigned i = 0; i < 32; i++) {
-        if (a & 1) {
-            lo += bLo;
-            if (lo < bLo)  // Carry out of the low bits?
-                hi += 1;
-            hi += bHi;
-            if ((a & 0xFFFFFFFE) == 0)
-                break;
-        }
-        bHi <<= 1;
-        if (bLo & 0x80000000)
-            bHi |= 1;
-
-        bLo <<= 1;
-        a >>= 1;
-    }
+    ASSERT(instr != nullptr);
 
-    // If the result is supposed to be negative, compute the two's complement
-    // of the double-word result.
-    if (negative) {
-        hi = ~hi;
-        lo = ~lo;
-        lo++;
-        if (lo == 0)
-            hi++;
-    }
+    const struct OpString *str = &OP_STRINGS[instr->opCode];
 
-    *hiPtr = (int) hi;
-    *loPtr = (int) lo;
+    ASSERT(instr->opCode <= MAX_OPCODE);
+    DEBUG('m', "At PC = 0x%X: ", registers[PC_REG]);
+    DEBUG_CONT('m', str->string, instr->RegFromType(str->args[0]),
+                    instr->RegFromType(str->args[1]),
+                    instr->RegFromType(str->args[2]));
+    DEBUG_CONT('m', "\n");
 }
 
 /// Execute one instruction from a user-level program.
@@ -178,9 +128,8 @@ Machine::ExecInstruction(const Instruction *instr)
     switch (instr->opCode) {
 
         case OP_ADD:
-            sum = registers[instr->rs] + registers[instr->rt];
-            if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT)
-                  && (registers[instr->rs] ^ sum) & SIGN_BIT) {
+            if (AddOverflows(registers[instr->rs], registers[instr->rt],
+                             &sum)) {
                 RaiseException(OVERFLOW_EXCEPTION, 0);
                 return;
             }
@@ -188,9 +137,7 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_ADDI:
-            sum = registers[instr->rs] + instr->extra;
-            if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT)
-                  && (instr->extra ^ sum) & SIGN_BIT) {
+            if (AddOverflows(registers[instr->rs], instr->extra, &sum)) {
                 RaiseException(OVERFLOW_EXCEPTION, 0);
                 return;
             }
@@ -251,29 +198,13 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_DIV:
-            if (registers[instr->rt] == 0) {
-                registers[LO_REG] = 0;
-                registers[HI_REG] = 0;
-            } else {
-                registers[LO_REG] = registers[instr->rs]
-                                    / registers[instr->rt];
-                registers[HI_REG] = registers[instr->rs]
-                                    % registers[instr->rt];
-            }
+            Divide(registers[instr->rs], registers[instr->rt],
+                   true, &registers[HI_REG], &registers[LO_REG]);
             break;
 
         case OP_DIVU:
-            rs = (unsigned) registers[instr->rs];
-            rt = (unsigned) registers[instr->rt];
-            if (rt == 0) {
-                registers[LO_REG] = 0;
-                registers[HI_REG] = 0;
-            } else {
-                tmp = rs / rt;
-                registers[LO_REG] = (int) tmp;
-                tmp = rs % rt;
-                registers[HI_REG] = (int) tmp;
-            }
+            Divide(registers[instr->rs], registers[instr->rt],
+                   false, &registers[HI_REG], &registers[LO_REG]);
             break;
 
         case OP_JAL:
@@ -518,9 +449,8 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_SUB:
-            diff = registers[instr->rs] - registers[instr->rt];
-            if ((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT
-                  && (registers[instr->rs] ^ diff) & SIGN_BIT) {
+            if (SubOverflows(registers[instr->rs], registers[instr->rt],
+                             &diff)) {
                 RaiseException(OVERFLOW_EXCEPTION, 0);
                 return;
             }
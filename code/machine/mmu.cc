@@ -39,22 +39,147 @@ MMU::MMU()
     for (unsigned i = 0; i < MEMORY_SIZE; i++)
           mainMemory[i] = 0;
 
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLB_SIZE];
-    for (unsigned i = 0; i < TLB_SIZE; i++)
-        tlb[i].valid = false;
-    pageTable = nullptr;
-#else  // Use linear page table.
+    decodedCache = new Instruction [MEMORY_SIZE / 4];
+    decodedValid = new bool [MEMORY_SIZE / 4];
+    for (unsigned i = 0; i < MEMORY_SIZE / 4; i++)
+        decodedValid[i] = false;
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++) {
+        decodedPages[i] = false;
+        codeVersion[i] = 0;
+    }
+
+    FlushTranslations();
+
     tlb = nullptr;
+    tlbLastUse = nullptr;
+    tlbReferenced = nullptr;
+    tlbSize = tlbWays = 0;
+    tlbHitCount = 0;
+    lastEntry = fetchEntry = nullptr;
+    currentAsid = 0;
     pageTable = nullptr;
+#ifdef USE_TLB
+    ConfigureTLB(TLB_SIZE, TLB_SIZE);
 #endif
 }
 
 MMU::~MMU()
 {
     delete [] mainMemory;
-    if (tlb != nullptr)
-        delete [] tlb;
+    delete [] decodedCache;
+    delete [] decodedValid;
+    delete [] tlb;
+    delete [] tlbLastUse;
+    delete [] tlbReferenced;
+}
+
+void
+MMU::ConfigureTLB(unsigned size, unsigned ways)
+{
+    // A single instruction may need its own page and a data page at the
+    // same time, so a set must hold at least two entries; otherwise both
+    // could keep evicting each other forever.
+    ASSERT(ways >= 2 && ways <= size && size % ways == 0);
+
+    delete [] tlb;
+    delete [] tlbLastUse;
+    delete [] tlbReferenced;
+
+    tlbSize = size;
+    tlbWays = ways;
+    tlb = new TranslationEntry[size];
+    tlbLastUse = new unsigned long[size];
+    tlbReferenced = new bool[size];
+    for (unsigned i = 0; i < size; i++) {
+        tlb[i].valid = false;
+        tlb[i].asid = 0;
+        tlbLastUse[i] = 0;
+        tlbReferenced[i] = false;
+    }
+
+    // Cached translations may point into the old TLB.
+    FlushTranslations();
+}
+
+unsigned
+MMU::GetTLBSize() const
+{
+    return tlbSize;
+}
+
+unsigned
+MMU::GetTLBWays() const
+{
+    return tlbWays;
+}
+
+unsigned
+MMU::GetTLBSet(unsigned vpn) const
+{
+    ASSERT(tlb != nullptr);
+    return vpn % (tlbSize / tlbWays) * tlbWays;
+}
+
+void
+MMU::SetASID(unsigned asid)
+{
+    ASSERT(asid < NUM_ASIDS);
+
+    // Cached translations come from entries of the previous address space.
+    if (asid != currentAsid)
+        FlushTranslations();
+    currentAsid = asid;
+}
+
+unsigned
+MMU::GetASID() const
+{
+    return currentAsid;
+}
+
+void
+MMU::InvalidateTranslation(unsigned vpn)
+{
+    CachedTranslation *cached = &translationCache[vpn % TRANSLATION_CACHE_SIZE];
+    if (cached->vpn == vpn)
+        cached->page = nullptr;
+}
+
+void
+MMU::FlushTranslations()
+{
+    for (unsigned i = 0; i < TRANSLATION_CACHE_SIZE; i++)
+        translationCache[i].page = nullptr;
+}
+
+unsigned long
+MMU::GetTLBLastUse(unsigned index) const
+{
+    ASSERT(index < tlbSize);
+    return tlbLastUse[index];
+}
+
+bool
+MMU::TestAndClearTLBReference(unsigned index)
+{
+    ASSERT(index < tlbSize);
+
+    bool referenced = tlbReferenced[index];
+    tlbReferenced[index] = false;
+    return referenced;
+}
+
+void
+MMU::NoteTLBHit(unsigned index)
+{
+    #ifdef DEMAND_LOADING
+        // Update the physical page usage table.
+        coreMap -> UpdateIdleCounter(tlb[index].physicalPage);
+    #endif
+
+    tlbLastUse[index] = ++tlbHitCount;
+    tlbReferenced[index] = true;
+    stats->numTlbHits++;
 }
 
 /// Read `size` (1, 2, or 4) bytes of virtual memory at `addr` into
@@ -122,6 +247,13 @@ MMU::WriteMem(unsigned addr, unsigned size, int value)
     if (e != NO_EXCEPTION)
         return e;
 
+    // Any decoding of the word being overwritten is now stale.
+    if (decodedPages[physicalAddress / PAGE_SIZE]
+          && decodedValid[physicalAddress / 4]) {
+        decodedValid[physicalAddress / 4] = false;
+        codeVersion[physicalAddress / PAGE_SIZE]++;
+    }
+
     switch (size) {
         case 1:
             mainMemory[physicalAddress]
@@ -145,8 +277,118 @@ MMU::WriteMem(unsigned addr, unsigned size, int value)
     return NO_EXCEPTION;
 }
 
+/// Fetch the instruction at virtual address `addr`, decoding it only if it
+/// is not in the decoded-instruction cache yet.
+///
+/// * `addr` is the virtual address of the instruction.
+/// * `instr` is the place to store a pointer to the decoded instruction.
+ExceptionType
+MMU::FetchInstruction(unsigned addr, const Instruction **instr)
+{
+    ASSERT(instr != nullptr);
+
+    unsigned physicalAddress;
+    ExceptionType e = TranslateFetch(addr, &physicalAddress);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    *instr = GetDecoded(physicalAddress);
+    return NO_EXCEPTION;
+}
+
 ExceptionType
-MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry) const
+MMU::TranslateFetch(unsigned addr, unsigned *physAddr)
+{
+    DEBUG('a', "Fetching instruction at VA 0x%X\n", addr);
+
+    ExceptionType e = Translate(addr, physAddr, 4, false);
+    if (e == NO_EXCEPTION)
+        fetchEntry = lastEntry;
+    return e;
+}
+
+void
+MMU::RepeatFetch()
+{
+    ASSERT(fetchEntry != nullptr && fetchEntry->valid);
+
+    // Same as the hit that translating the address again would find.
+    if (tlb != nullptr)
+        NoteTLBHit(fetchEntry - tlb);
+    fetchEntry->use = true;
+}
+
+/// Translate `size` bytes of virtual memory starting at `addr`, which must
+/// not cross a page boundary.
+///
+/// * `addr` is the virtual address of the first byte.
+/// * `size` is the number of bytes to be accessed.
+/// * `writing` tells whether the bytes are going to be overwritten.
+/// * `physAddr` is the place to store the physical address of `addr`.
+ExceptionType
+MMU::TranslateRange(unsigned addr, unsigned size, bool writing,
+                    unsigned *physAddr)
+{
+    ASSERT(size > 0 && addr % PAGE_SIZE + size <= PAGE_SIZE);
+
+    DEBUG('a', "Accessing VA 0x%X, size %u\n", addr, size);
+
+    ExceptionType e = Translate(addr, physAddr, 1, writing);
+    if (e != NO_EXCEPTION || !writing)
+        return e;
+
+    unsigned frame = *physAddr / PAGE_SIZE;
+    if (decodedPages[frame]) {
+        bool stale = false;
+        for (unsigned i = *physAddr / 4; i <= (*physAddr + size - 1) / 4; i++)
+            if (decodedValid[i]) {
+                decodedValid[i] = false;
+                stale = true;
+            }
+        if (stale)
+            codeVersion[frame]++;
+    }
+    return NO_EXCEPTION;
+}
+
+const Instruction *
+MMU::GetDecoded(unsigned physAddr)
+{
+    ASSERT(physAddr % 4 == 0 && physAddr < MEMORY_SIZE);
+
+    unsigned index = physAddr / 4;
+    Instruction *cached = &decodedCache[index];
+    if (!decodedValid[index]) {
+        cached->value = WordToHost(*(unsigned *) &mainMemory[physAddr]);
+        cached->Decode();
+        decodedValid[index] = true;
+        decodedPages[physAddr / PAGE_SIZE] = true;
+    }
+    return cached;
+}
+
+unsigned
+MMU::GetCodeVersion(unsigned frame) const
+{
+    ASSERT(frame < NUM_PHYS_PAGES);
+    return codeVersion[frame];
+}
+
+void
+MMU::InvalidateDecodedPage(unsigned frame)
+{
+    ASSERT(frame < NUM_PHYS_PAGES);
+
+    if (!decodedPages[frame])
+        return;
+    for (unsigned i = 0; i < PAGE_SIZE / 4; i++)
+        decodedValid[frame * PAGE_SIZE / 4 + i] = false;
+    decodedPages[frame] = false;
+    codeVersion[frame]++;
+}
+
+ExceptionType
+MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry)
 {
     ASSERT(entry != nullptr);
 
@@ -169,21 +411,20 @@ MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry) const
         return NO_EXCEPTION;
 
     } else {
-        // Use the TLB.
-
-        unsigned i;
-        for (i = 0; i < TLB_SIZE; i++)
-            if (tlb[i].valid && tlb[i].virtualPage == vpn) {
-                #ifdef LRU
-                    // Update the physical page usage table.
-                    coreMap -> UpdateIdleCounter(tlb[i].physicalPage);
-                #endif
-
+        // Use the TLB; only the set for `vpn` can hold it, tagged with the
+        // running address space.
+
+        unsigned set = GetTLBSet(vpn);
+        for (unsigned i = set; i < set + tlbWays; i++)
+            if (tlb[i].valid && tlb[i].virtualPage == vpn
+                  && tlb[i].asid == currentAsid) {
+                NoteTLBHit(i);
                 *entry = &tlb[i];  // FOUND!
                 return NO_EXCEPTION;
             }
 
         // Not found.
+        stats->numTlbMisses++;
         DEBUG_CONT('a', "no valid TLB entry found for this virtual page!\n");
         return PAGE_FAULT_EXCEPTION;  // Really, this is a TLB fault, the
                                       // page may be in memory, but not in
@@ -225,24 +466,45 @@ MMU::Translate(unsigned virtAddr, unsigned *physAddr,
     unsigned vpn    = (unsigned) virtAddr / PAGE_SIZE;
     unsigned offset = (unsigned) virtAddr % PAGE_SIZE;
 
+    // Look for the page in the translation cache first.  A hit was checked
+    // when it was cached, and the kernel invalidates it if the mapping has
+    // changed since, so it only needs to allow the access.
+    CachedTranslation *cached
+      = &translationCache[vpn % TRANSLATION_CACHE_SIZE];
     TranslationEntry *entry;
-    ExceptionType exception = RetrievePageEntry(vpn, &entry);
-    if (exception != NO_EXCEPTION)
-        return exception;
-
-    if (entry->readOnly && writing) {  // Trying to write to a read-only
-                                       // page.
-        DEBUG_CONT('a', "%u mapped read-only!\n", virtAddr);
-        return READ_ONLY_EXCEPTION;
-    }
+    char *page;
+
+    if (cached->page != nullptr && cached->vpn == vpn
+          && (cached->writable || !writing)) {
+        entry = cached->entry;
+        page = cached->page;
+        if (tlb != nullptr)
+            NoteTLBHit(entry - tlb);
+    } else {
+        ExceptionType exception = RetrievePageEntry(vpn, &entry);
+        if (exception != NO_EXCEPTION)
+            return exception;
+
+        if (entry->readOnly && writing) {  // Trying to write to a read-only
+                                           // page.
+            DEBUG_CONT('a', "%u mapped read-only!\n", virtAddr);
+            return READ_ONLY_EXCEPTION;
+        }
+
+        unsigned pageFrame = entry->physicalPage;
 
-    unsigned pageFrame = entry->physicalPage;
+        // If the `pageFrame` is too big, there is something really wrong!
+        // An invalid translation was loaded into the page table or TLB.
+        if (pageFrame >= NUM_PHYS_PAGES) {
+            DEBUG_CONT('a', "frame %u > %u!\n", pageFrame, NUM_PHYS_PAGES);
+            return BUS_ERROR_EXCEPTION;
+        }
 
-    // If the `pageFrame` is too big, there is something really wrong!  An
-    // invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NUM_PHYS_PAGES) {
-        DEBUG_CONT('a', "frame %u > %u!\n", pageFrame, NUM_PHYS_PAGES);
-        return BUS_ERROR_EXCEPTION;
+        page = &mainMemory[pageFrame * PAGE_SIZE];
+        cached->vpn      = vpn;
+        cached->page     = page;
+        cached->writable = !entry->readOnly;
+        cached->entry    = entry;
     }
 
     // Set the `use` and `dirty` flags.
@@ -250,7 +512,8 @@ MMU::Translate(unsigned virtAddr, unsigned *physAddr,
     if (writing)
         entry->dirty = true;
 
-    *physAddr = pageFrame * PAGE_SIZE + offset;
+    lastEntry = entry;
+    *physAddr = page - mainMemory + offset;
     ASSERT(*physAddr >= 0 && *physAddr + size <= MEMORY_SIZE);
     DEBUG_CONT('a', "physical address 0x%X\n", *physAddr);
     return NO_EXCEPTION;
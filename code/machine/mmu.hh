@@ -11,6 +11,7 @@
 
 #include "exception_type.hh"
 #include "disk.hh"
+#include "instruction.hh"
 #include "translation_entry.hh"
 
 
@@ -22,6 +23,13 @@ const unsigned PAGE_SIZE = SECTOR_SIZE;  ///< Set the page size equal to the
 const unsigned NUM_PHYS_PAGES = 32;
 const unsigned MEMORY_SIZE = NUM_PHYS_PAGES * PAGE_SIZE;
 const unsigned TLB_SIZE = 4;  ///< if there is a TLB, make it small.
+                              ///< This is the default size; see
+                              ///< `MMU::ConfigureTLB`.
+const unsigned NUM_ASIDS = 64;  ///< Number of address space identifiers
+                                ///< for TLB entries (6 bits, as in the
+                                ///< R2000/R3000).
+const unsigned TRANSLATION_CACHE_SIZE = 64;  ///< Host-side cache of recent
+                                             ///< translations; see `MMU`.
 
 
 /// This class simulates an MMU (memory management unit) that can use either
@@ -41,6 +49,92 @@ public:
 
     ExceptionType WriteMem(unsigned addr, unsigned size, int value);
 
+    /// Fetch the instruction at virtual address `addr`, already decoded.
+    ///
+    /// Translation happens exactly as in `ReadMem`, so TLB misses and page
+    /// faults are raised as usual; only the memory read and the decoding
+    /// are skipped when the word was decoded before.  `instr` is left
+    /// pointing to storage owned by the MMU, which stays valid until the
+    /// next fetch.
+    ExceptionType FetchInstruction(unsigned addr, const Instruction **instr);
+
+    /// Translate the address of an instruction about to be fetched, with
+    /// the same checks and side effects as a 4-byte `ReadMem`.
+    ExceptionType TranslateFetch(unsigned addr, unsigned *physAddr);
+
+    /// Account for fetching another instruction from the page of the last
+    /// successful `TranslateFetch`, with the side effects of translating it
+    /// again.  Only valid while nothing could have changed that translation,
+    /// that is, as long as no exception was raised since.
+    void RepeatFetch();
+
+    /// Translate a run of `size` bytes starting at `addr`, all within one
+    /// page, for the kernel to copy directly to or from `mainMemory`.
+    ///
+    /// Checks and side effects are those of a single-byte access; when
+    /// `writing`, any decoded instruction in the run is also forgotten, as
+    /// `WriteMem` would do.
+    ExceptionType TranslateRange(unsigned addr, unsigned size, bool writing,
+                                 unsigned *physAddr);
+
+    /// Return the decoded instruction at physical address `physAddr`,
+    /// decoding it if needed.
+    const Instruction *GetDecoded(unsigned physAddr);
+
+    /// Return a counter that changes every time decoded code from physical
+    /// page `frame` becomes stale, so that structures derived from it can
+    /// check whether they are still current.
+    unsigned GetCodeVersion(unsigned frame) const;
+
+    /// Rebuild the TLB with `size` entries, grouped into sets of `ways`
+    /// entries each.  A page can only be cached in the set given by its
+    /// number modulo the number of sets; `ways == size` gives a fully
+    /// associative TLB.  Sets need at least two entries.  All entries
+    /// start invalid.
+    void ConfigureTLB(unsigned size, unsigned ways);
+
+    /// Number of entries in the TLB.
+    unsigned GetTLBSize() const;
+
+    /// Number of entries in each set of the TLB.
+    unsigned GetTLBWays() const;
+
+    /// Index in `tlb` of the first entry of the set where virtual page
+    /// `vpn` can be cached.
+    unsigned GetTLBSet(unsigned vpn) const;
+
+    /// Set the address space identifier that TLB entries must carry to
+    /// be used for translation.
+    void SetASID(unsigned asid);
+
+    /// Return the address space identifier currently in use.
+    unsigned GetASID() const;
+
+    /// Replacement assistance: a stamp that grows with every TLB hit,
+    /// telling when entry `index` was last used.
+    unsigned long GetTLBLastUse(unsigned index) const;
+
+    /// Replacement assistance: return whether TLB entry `index` has been
+    /// used since the last call for it, and clear that mark.
+    bool TestAndClearTLBReference(unsigned index);
+
+    /// Forget the cached translation of virtual page `vpn`, if any.
+    ///
+    /// The kernel must call this whenever it invalidates or replaces a TLB
+    /// entry, or changes where a page table entry points or whether it is
+    /// valid or read-only.  Clearing `use` and `dirty` needs no call.
+    void InvalidateTranslation(unsigned vpn);
+
+    /// Forget every cached translation, as when switching page tables.
+    void FlushTranslations();
+
+    /// Forget every instruction decoded from physical page `frame`.
+    ///
+    /// Writes performed through `WriteMem` take care of themselves, but the
+    /// kernel must call this whenever it changes the contents of a frame
+    /// directly through `mainMemory` (loading a page, swapping it out...).
+    void InvalidateDecodedPage(unsigned frame);
+
     /// Data structures -- all of these are accessible to Nachos kernel code.
     /// “Public” for convenience.
     ///
@@ -78,9 +172,61 @@ public:
 
 private:
 
+    /// A translation recently completed by `Translate`.
+    struct CachedTranslation {
+        unsigned vpn;  ///< Virtual page number.
+        char *page;  ///< Start of the frame in `mainMemory`, or null if the
+                     ///< slot is empty.
+        bool writable;  ///< Whether the page is not read-only.
+        TranslationEntry *entry;  ///< The entry that maps `vpn`, whose
+                                  ///< `use` and `dirty` flags hits still set.
+    };
+
+    /// Direct-mapped cache of translations, indexed by virtual page number.
+    ///
+    /// A hit goes straight to the frame, without looking at the page table
+    /// or searching the TLB, and without checking the entry again.  It is
+    /// only correct because the kernel invalidates a slot whenever the
+    /// mapping behind it changes (see `InvalidateTranslation`), and because
+    /// it is flushed when the TLB is reconfigured or the ASID changes.
+    CachedTranslation translationCache[TRANSLATION_CACHE_SIZE];
+
+    /// Decoded-instruction cache, indexed by physical word (that is,
+    /// physical address divided by 4).
+    Instruction *decodedCache;
+
+    /// Whether each entry of `decodedCache` holds a valid decoding.
+    bool *decodedValid;
+
+    /// Whether a physical page may have valid entries in `decodedCache`.
+    /// Lets writes to pages that never held code skip the cache entirely.
+    bool decodedPages[NUM_PHYS_PAGES];
+
+    /// Code version of every physical page; see `GetCodeVersion`.
+    unsigned codeVersion[NUM_PHYS_PAGES];
+
     /// Retrieve a page entry either from a page table or the TLB.
     ExceptionType RetrievePageEntry(unsigned vpn,
-                                    TranslationEntry **entry) const;
+                                    TranslationEntry **entry);
+
+    /// Account for a hit on TLB entry `index`.
+    void NoteTLBHit(unsigned index);
+
+    /// Entry used by the last successful `Translate`, and by the last
+    /// successful `TranslateFetch`.
+    TranslationEntry *lastEntry;
+    TranslationEntry *fetchEntry;
+
+    unsigned currentAsid;  ///< Identifier of the running address space.
+
+    unsigned tlbSize;  ///< Number of entries in `tlb`.
+    unsigned tlbWays;  ///< Entries in each set of `tlb`.
+
+    unsigned long tlbHitCount;  ///< Number of TLB hits so far.
+    unsigned long *tlbLastUse;  ///< Value of `tlbHitCount` at the last hit
+                                ///< of each TLB entry.
+    bool *tlbReferenced;  ///< Whether each TLB entry was used since its
+                          ///< mark was last cleared.
 
     /// Translate an address, and check for alignment.
     ///
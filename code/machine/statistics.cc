@@ -19,10 +19,17 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numMemoryReads = numPageFaults = numPacketsSent = numPacketsRecvd = 0;
-#ifdef DFS_TICKS_FIX
-    tickResets = 0;
-#endif
-
+    numTlbHits = numTlbMisses = 0;
+    tlbPolicy = "none";
+    numPageEvictions = 0;
+    numPagerCleanings = 0;
+    pagePolicy = "none";
+    numSwapWrites = 0;
+    numSwapReads = 0;
+    numPrefetchedPages = 0;
+    numZeroFillPages = 0;
+    numSharedPages = 0;
+    numCopiesOnWrite = 0;
 }
 
 /// Print performance metrics, when we have finished everything at system
@@ -30,15 +37,11 @@ Statistics::Statistics()
 void
 Statistics::Print()
 {
-#ifdef DFS_TICKS_FIX
-    if (tickResets != 0)
-        printf("WARNING: the tick counter was reset %lu times; the following"
-               " statistics may be invalid.\n\n", tickResets);
-#endif
-    printf("Ticks: total %u, idle %u, system %u, user %u\n",
+    printf("Ticks: total %llu, idle %llu, system %llu, user %llu\n",
            totalTicks, idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %u, writes %u\n", numDiskReads, numDiskWrites);
-    printf("Console I/O: reads %u, writes %u\n",
+    printf("Disk I/O: reads %llu, writes %llu\n",
+           numDiskReads, numDiskWrites);
+    printf("Console I/O: reads %llu, writes %llu\n",
            numConsoleCharsRead, numConsoleCharsWritten);
     
     printf("Virtual memory: ");
@@ -46,13 +49,30 @@ Statistics::Print()
         printf("no memory reads\n");
     else{
         if(numMemoryReads == numPageFaults)
-            printf("all %u memory reads failed\n", numMemoryReads);
+            printf("all %llu memory reads failed\n", numMemoryReads);
         else
-            printf("memory reads %u, successful reads %u, page faults %u, hit ratio %.4f\n",
+            printf("memory reads %llu, successful reads %llu, page faults %llu, hit ratio %.4f\n",
                    numMemoryReads, numMemoryReads - numPageFaults, numPageFaults, 
                    (float) (numMemoryReads - 2 * numPageFaults) / (numMemoryReads - numPageFaults) * 100);
     }
-    
-    printf("Network I/O: packets received %u, sent %u\n",
+
+#ifdef USE_TLB
+    if (numTlbHits + numTlbMisses != 0)
+        printf("TLB (%s replacement): hits %llu, misses %llu, hit ratio %.4f\n",
+               tlbPolicy, numTlbHits, numTlbMisses,
+               (float) numTlbHits / (numTlbHits + numTlbMisses) * 100);
+#endif
+#ifdef DEMAND_LOADING
+    printf("Paging (%s replacement): evictions %llu, swap writes %llu"
+           " (%llu by the pager), swap reads %llu, prefetched pages %llu,"
+           " zero-fill pages %llu\n",
+           pagePolicy, numPageEvictions, numSwapWrites, numPagerCleanings,
+           numSwapReads, numPrefetchedPages,
+           numZeroFillPages);
+    printf("Sharing: shared pages %llu, copies on write %llu\n",
+           numSharedPages, numCopiesOnWrite);
+#endif
+
+    printf("Network I/O: packets received %llu, sent %llu\n",
            numPacketsRecvd, numPacketsSent);
 }
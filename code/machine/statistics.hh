@@ -15,51 +15,85 @@
 /// Nachos behavior -- how much time (ticks) elapsed, how many user
 /// instructions executed, etc.
 ///
-/// The fields in this class are public to make it easier to update.
+/// The fields in this class are public to make it easier to update.  They
+/// are all 64-bit, so that even the clock never wraps around.
 class Statistics {
 public:
 
     /// Total time running Nachos.
-    unsigned totalTicks;
+    unsigned long long totalTicks;
 
     /// Time spent idle (no threads to run).
-    unsigned idleTicks;
+    unsigned long long idleTicks;
 
     /// Time spent executing system code.
-    unsigned systemTicks;
+    unsigned long long systemTicks;
 
     /// Time spent executing user code (this is also equal to # of user
     /// instructions executed).
-    unsigned userTicks;
+    unsigned long long userTicks;
 
     /// Number of disk read requests.
-    unsigned numDiskReads;
+    unsigned long long numDiskReads;
 
     /// Number of disk write requests.
-    unsigned numDiskWrites;
+    unsigned long long numDiskWrites;
 
     /// Number of characters read from the keyboard.
-    unsigned numConsoleCharsRead;
+    unsigned long long numConsoleCharsRead;
 
     /// Number of characters written to the display.
-    unsigned numConsoleCharsWritten;
+    unsigned long long numConsoleCharsWritten;
 
     ///Number of memory reads.
-    unsigned numMemoryReads;
+    unsigned long long numMemoryReads;
 
     /// Number of virtual memory page faults.
-    unsigned numPageFaults;
+    unsigned long long numPageFaults;
+
+    /// Number of TLB lookups that found their page.
+    unsigned long long numTlbHits;
+
+    /// Number of TLB lookups that missed, trapping to the kernel.
+    unsigned long long numTlbMisses;
+
+    /// Name of the TLB replacement policy the counters above belong to.
+    const char *tlbPolicy;
+
+    /// Number of pages sent to swap to make room for others.
+    unsigned long long numPageEvictions;
+
+    /// Number of dirty pages written back in advance by the pager thread.
+    unsigned long long numPagerCleanings;
+
+    /// Name of the page replacement policy that chose those pages.
+    const char *pagePolicy;
+
+    /// Number of pages written to swap; clean pages are evicted without it.
+    unsigned long long numSwapWrites;
+
+    /// Number of pages read back from swap.
+    unsigned long long numSwapReads;
+
+    /// Number of faults served with a page of the executable that another
+    /// process had already loaded.
+    unsigned long long numSharedPages;
+
+    /// Number of shared pages copied because a process wrote to them.
+    unsigned long long numCopiesOnWrite;
+
+    /// Number of pages of uninitialized data or stack loaded by just zeroing
+    /// a frame.
+    unsigned long long numZeroFillPages;
+
+    /// Number of pages loaded ahead of time, along with a faulting one.
+    unsigned long long numPrefetchedPages;
 
     /// Number of packets sent over the network.
-    unsigned numPacketsSent;
+    unsigned long long numPacketsSent;
 
     /// Number of packets received over the network.
-    unsigned numPacketsRecvd;
-
-#ifdef DFS_TICKS_FIX
-    /// Number of times the tick count gets reset.
-    unsigned long tickResets;
-#endif
+    unsigned long long numPacketsRecvd;
 
     /// Initialize everything to zero.
     Statistics();
@@ -36,6 +36,7 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -178,6 +179,17 @@ Tell(int fd)
 #endif
 }
 
+/// Identify the file open as `fd`, by its device and inode numbers.
+unsigned long
+FileIdentity(int fd)
+{
+    struct stat status;
+    int retVal = fstat(fd, &status);
+    ASSERT(retVal == 0);
+    return (unsigned long) status.st_ino
+           ^ (unsigned long) status.st_dev << (sizeof (unsigned long) * 4);
+}
+
 /// Close a file.
 ///
 /// Abort on error.
@@ -40,6 +40,11 @@ extern void Lseek(int fd, int offset, int whence);
 
 extern int Tell(int fd);
 
+/// Return a number that identifies the file open as `fd` among every file
+/// in the host, so that two descriptors for the same file give the same
+/// number.
+extern unsigned long FileIdentity(int fd);
+
 extern void Close(int fd);
 
 extern bool Unlink(const char *name);
@@ -47,19 +47,51 @@ Timer::Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom)
     randomize = doRandom;
     handler   = timerHandler;
     arg       = callArg;
+    running   = false;
+    pending   = false;
 
     // Schedule the first interrupt from the timer device.
-    interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
-                        TIMER_INT);
+    Start();
+}
+
+/// Stop the timer.
+///
+/// An interrupt already scheduled cannot be taken back; it is just ignored
+/// when it fires, and no other one is scheduled.
+void
+Timer::Stop()
+{
+    running = false;
+}
+
+/// Start the timer again, if it was stopped.
+///
+/// If the interrupt scheduled before stopping has not fired yet, it is kept,
+/// so starting and stopping repeatedly never piles up interrupts.
+void
+Timer::Start()
+{
+    running = true;
+    if (!pending) {
+        pending = true;
+        interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
+                            TIMER_INT);
+    }
 }
 
 /// Routine to simulate the interrupt generated by the hardware timer device.
 ///
-/// Schedule the next interrupt, and invoke the interrupt handler.
+/// Schedule the next interrupt, and invoke the interrupt handler, unless the
+/// timer was stopped.
 void
 Timer::TimerExpired()
 {
+    pending = false;
+    if (!running)
+        return;
+
     // Schedule the next timer device interrupt.
+    pending = true;
     interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
                         TIMER_INT);
 
@@ -10,6 +10,9 @@
 /// In order to introduce some randomness into time-slicing, if `doRandom` is
 /// set, then the interrupt comes after a random number of ticks.
 ///
+/// The timer can be stopped while there is nothing to time-slice, and
+/// started again later.
+///
 /// DO NOT CHANGE -- part of the machine emulation
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
@@ -34,6 +37,12 @@ public:
 
     ~Timer() {}
 
+    /// Stop generating interrupts, until `Start` is called.
+    void Stop();
+
+    /// Generate interrupts again, if the timer was stopped.
+    void Start();
+
     /// Internal routines to the timer emulation -- DO NOT call these.
 
     /// Called internally when the hardware timer generates an interrupt.
@@ -46,6 +55,8 @@ private:
     bool randomize;  ///< Set if we need to use a random timeout delay.
     VoidFunctionPtr handler;  ///< Timer interrupt handler.
     void *arg;  ///< Argument to pass to interrupt handler.
+    bool running;  ///< Set unless the timer was stopped.
+    bool pending;  ///< Set while an interrupt of the timer is scheduled.
 
 };
 
@@ -54,6 +54,11 @@ public:
     /// This bit is set by the hardware every time the page is modified.
     bool dirty;
 
+    /// Address space identifier.  Only meaningful in TLB entries: an entry
+    /// only translates for the address space whose identifier is loaded in
+    /// the MMU, so entries of several address spaces can coexist.
+    unsigned asid;
+
 };
 
 
@@ -10,8 +10,12 @@
 /// Usage
 /// =====
 ///
-///     nachos [-d <debugflags>] [-p] [-rs <random seed #>] [-z]
-///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///     nachos [-d <debugflags>] [-p] [-pl <levels>]
+///            [-fq <quanta> <boost period>] [-st] [-ts <ticks>]
+///            [-rs <random seed #>] [-z] [-s] [-bb] [-x <nachos file>]
+///            [-tc <consoleIn> <consoleOut>] [-ta <count>]
+///            [-tlb <entries> <ways>] [-tlbp <policy>] [-pp <policy>]
+///            [-pd <low> <high>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-tf]
 ///            [-n <network reliability>] [-id <machine id>]
@@ -23,6 +27,19 @@
 /// * `-d`  -- causes certain debugging messages to be printed (cf.
 ///   `utility.hh`).
 /// * `-p`  -- enables preemptive multitasking for kernel threads.
+/// * `-pl` -- sets the number of thread priorities (10 by default, at most
+///   32).
+/// * `-fq` -- schedules with multilevel feedback: threads go down a priority
+///   each time they use up the quantum of their level, given in ticks as a
+///   comma-separated list from the highest level down (the last one applies
+///   to the rest), go back up when woken by a device, and all go back up
+///   every `boost period` ticks.
+/// * `-st` -- schedules by strides: threads share the CPU in proportion to
+///   their tickets (100 each, unless changed with the `Tickets` system
+///   call), whatever their priorities.
+/// * `-ts` -- sets how many ticks threads run before they can be preempted
+///   (by default, on every timer interrupt or forced context switch); the
+///   `TimeSlice` system call changes it for a single user program.
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
 /// * `-z`  -- prints version and copyright information, and exits.
 ///
@@ -30,8 +47,30 @@
 /// ----------------------
 ///
 /// * `-s`  -- causes user programs to be executed in single-step mode.
+/// * `-bb` -- runs user programs with the basic-block threaded-code engine
+///   instead of the reference interpreter; must come before `-x`.
 /// * `-x`  -- runs a user program.
 /// * `-tc` -- tests the console.
+/// * `-ta` -- checks the simulator arithmetic against its reference
+///   implementation, over a number of random operands.
+///
+/// *USE_TLB* options
+/// -----------------
+///
+/// * `-tlb`  -- sets the number of TLB entries, and how many of them form
+///   each set (at least 2; as many as entries gives a fully associative
+///   TLB).
+/// * `-tlbp` -- sets the TLB replacement policy: `fifo` (the default),
+///   `lru`, `random` or `clock`.
+///
+/// *DEMAND_LOADING* options
+/// ------------------------
+///
+/// * `-pp` -- sets the page replacement policy: `fifo`, `lru` or `clock`.
+///   The default is `lru` if compiled with *LRU*, and `fifo` otherwise.
+/// * `-pd` -- starts a pager thread that writes dirty pages back to swap in
+///   the background whenever a page fault leaves `low` or fewer free
+///   frames, until `high` frames are free or hold clean pages.
 ///
 /// *FILESYS* options
 /// -----------------
@@ -80,6 +119,7 @@ void SynchConsoleTest(const char *in, const char *out);
 void MailTest(int networkID);
 void TestSequentialProcesses(int processAmount);
 void TestConcurrentProcesses(int processAmount);
+void AluTest(unsigned count);
 
 static inline void
 PrintVersion()
@@ -124,6 +164,8 @@ main(int argc, char **argv)
             ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-bb")) {  // Use the block engine.
+            machine->EnableBlockEngine();
         } else if (!strcmp(*argv, "-tc")) {  // Test the console.
             if (argc == 1)
                 ConsoleTest(nullptr, nullptr);
@@ -146,6 +188,10 @@ main(int argc, char **argv)
             interrupt->Halt();  // Once we start the console, then Nachos
                                 // will loop forever waiting for console
                                 // input.
+        } else if (!strcmp(*argv, "-ta")) {  // Test the simulator ALU.
+            ASSERT(argc > 1);
+            AluTest(atoi(*(argv + 1)));
+            argCount = 2;
         }
 #ifdef DEMAND_LOADING
 	if (!strcmp(*argv, "-tsp")) { // Run a test with sequential processes.			
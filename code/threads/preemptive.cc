@@ -24,6 +24,10 @@ static void LetMeBeMonitored();
 
 static bool inContextSwitch = false;
 
+// Whether context switches are to be forced.  The monitor reads a whole word
+// from the child, so this one is a word too.
+static long preemptionOn = 1;
+
 /// Set up the preemptive scheduler.
 ///
 /// * `timeSliceLength` means how many machine instructions will last the
@@ -51,6 +55,22 @@ PreemptiveScheduler::SetUp(unsigned long timeSliceLength)
     }
 }
 
+/// Stop forcing context switches.
+///
+/// Called by the child process; the monitor finds it out at the end of the
+/// current time slice.
+void
+PreemptiveScheduler::Stop()
+{
+    preemptionOn = 0;
+}
+
+void
+PreemptiveScheduler::Start()
+{
+    preemptionOn = 1;
+}
+
 void
 LetMeBeMonitored()
 {
@@ -85,11 +105,14 @@ MonitorProcess(int childPid, unsigned long timeSliceLength)
         // From time to time, insert machine code to force a context switch.
         if (instructionCounter % timeSliceLength == 0)
         {
-            // Get child value of `inContextSwitch`.
+            // Get child value of `inContextSwitch` and `preemptionOn`.  Only
+            // the first byte of the word read belongs to `inContextSwitch`.
             long incs = ptrace(PTRACE_PEEKDATA, childPid,
-                               (long) &inContextSwitch, nullptr);
+                               (long) &inContextSwitch, nullptr) & 0xFF;
+            long on = ptrace(PTRACE_PEEKDATA, childPid,
+                             (long) &preemptionOn, nullptr);
 
-            if (incs == 0) {
+            if (incs == 0 && on != 0) {
                 DEBUG('p', "Preemptive scheduler: "
                            "forcing a context switch at instruction %lld\n",
                       instructionCounter);
@@ -150,10 +173,13 @@ ContextSwitch(void)
 
     inContextSwitch = true;
 
-    // Make a context switch if interrupts are enabled.
+    // Make a context switch if interrupts are enabled, and the scheduler
+    // wants one.
     if (interrupt->GetLevel() == INT_ON) {
+        bool preempt = scheduler->ShouldPreempt(currentThread);
         inContextSwitch = false;
-        currentThread->Yield();
+        if (preempt)
+            currentThread->Yield();
     } else {
         interrupt->YieldOnReturn();
         inContextSwitch = false;
@@ -28,6 +28,12 @@ public:
     ///   x86 machine instructions.
     void SetUp(unsigned long timeSliceLength);
 
+    /// Stop forcing context switches, until `Start` is called.
+    void Stop();
+
+    /// Force context switches again, if they were stopped.
+    void Start();
+
 };
 
 
@@ -9,8 +9,8 @@
 /// needed to wait for a lock, and the lock was busy, we would end up calling
 /// `FindNextToRun`, and that would put us in an infinite loop.
 ///
-/// Very simple implementation -- no priorities, straight FIFO.  Might need
-/// to be improved in later assignments.
+/// Threads are kept in one FIFO queue per priority, and the highest
+/// priority with a ready thread is always run first.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2018 Docentes de la Universidad Nacional de Rosario.
@@ -19,21 +19,83 @@
 
 
 #include "scheduler.hh"
+#include "synch.hh"
 #include "system.hh"
 
 
+/// Stride of a thread holding a single ticket; strides of other threads are
+/// this divided by their tickets.
+static const unsigned STRIDE1 = 1 << 20;
+
+
 /// Initialize the lists of ready but not running threads to empty.
-Scheduler::Scheduler()
+///
+/// * `levels` is the number of priorities, from 0 to `levels - 1`.
+Scheduler::Scheduler(int levels)
 {
+    ASSERT(levels > 0 && levels <= MAX_PRIORITY_LEVELS);
+
+    priorityAmount = levels;
     for(int i = 0; i < priorityAmount; i++)
-        readyList[i] = new List<Thread *>;
+        readyHead[i] = readyTail[i] = nullptr;
+    readyLevels = 0;
+
+    policy = SCHED_PRIORITY;
+    boostPeriod = nextBoost = 0;
+    boostCount = 0;
+    virtualPass = 0;
+    defaultTimeSlice = 0;
+    slicingStopped = false;
 }
 
 /// De-allocate the lists of ready threads.
 Scheduler::~Scheduler()
+{}
+
+void
+Scheduler::Enqueue(Thread *thread)
 {
-    for(int i = 0; i < priorityAmount; i++)
-        delete readyList[i];
+    // Stride scheduling keeps a single queue, sorted by pass.
+    int priority = 0;
+    Thread *prev = readyTail[0];
+    if(policy == SCHED_STRIDE)
+        while(prev != nullptr && prev->pass > thread->pass)
+            prev = prev->prevReady;
+    else {
+        priority = thread->GetPriority();
+        prev = readyTail[priority];
+    }
+
+    thread->prevReady = prev;
+    thread->nextReady = prev != nullptr ? prev->nextReady
+                                        : readyHead[priority];
+    if(prev != nullptr)
+        prev->nextReady = thread;
+    else
+        readyHead[priority] = thread;
+    if(thread->nextReady != nullptr)
+        thread->nextReady->prevReady = thread;
+    else
+        readyTail[priority] = thread;
+    readyLevels |= 1U << priority;
+}
+
+void
+Scheduler::Dequeue(Thread *thread)
+{
+    int priority = policy == SCHED_STRIDE ? 0 : thread->GetPriority();
+
+    if(thread->prevReady != nullptr)
+        thread->prevReady->nextReady = thread->nextReady;
+    else
+        readyHead[priority] = thread->nextReady;
+    if(thread->nextReady != nullptr)
+        thread->nextReady->prevReady = thread->prevReady;
+    else
+        readyTail[priority] = thread->prevReady;
+
+    if(readyHead[priority] == nullptr)
+        readyLevels &= ~(1U << priority);
 }
 
 /// Mark a thread as ready, but not running.
@@ -44,14 +106,31 @@ void
 Scheduler::ReadyToRun(Thread *thread)
 {
     ASSERT(thread != nullptr);
+    ASSERT(thread->GetStatus() != READY);
 
     DEBUG('t', "Putting thread %s on ready list %d (ReadyToRun)\n",
           thread->GetName(), thread->GetPriority());
 
+    if(thread->GetStatus() == RUNNING)
+        Charge(thread);  // Preempted, or yielding.
+    else if(policy == SCHED_FEEDBACK){
+        if(thread->GetStatus() == JUST_CREATED || thread->waitingIO
+             || thread->boostCount != boostCount)
+            Raise(thread);
+    } else if(policy == SCHED_STRIDE && thread->pass < virtualPass)
+        thread->pass = virtualPass;
+
     thread->SetStatus(READY);
-    readyList[thread->GetPriority()]->Append(thread);
+    Enqueue(thread);
 
-    // DEBUG('t', "Priority Queue size: %d\n", readyList[thread->GetPriority()] -> Length());
+    if(slicingStopped){
+        DEBUG('t', "A thread is ready, starting time slicing\n");
+        slicingStopped = false;
+        if(timer != nullptr)
+            timer->Start();
+        if(preemptiveScheduler != nullptr)
+            preemptiveScheduler->Start();
+    }
 }
 
 /// Return the next thread to be scheduled onto the CPU.
@@ -62,13 +141,51 @@ Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-    // Returns the first thread in the non-empty queue with the highest priority
-    for(int i = priorityAmount - 1; i >= 0; i--)
-        if(not readyList[i]->IsEmpty())
-            return readyList[i]->Pop();
+    if(policy == SCHED_FEEDBACK && stats->totalTicks >= nextBoost)
+        Boost();
+
+    // If no thread is found, there are no ready threads and nullptr is
+    // returned.
+    if(readyLevels == 0)
+        return nullptr;
+
+    // Returns the first thread in the non-empty queue with the highest
+    // priority.
+    int priority = 31 - __builtin_clz(readyLevels);
+    Thread *thread = readyHead[priority];
+    Dequeue(thread);
+    return thread;
+}
+
+/// Return the next thread to be scheduled onto the CPU in place of
+/// `current`, which offers to yield it.
+///
+/// Under feedback scheduling, `current` is charged for the time it ran, and
+/// keeps the CPU unless there is a ready thread of at least its priority.
+/// Under stride scheduling, it keeps the CPU unless a ready thread has a
+/// lower pass.  Otherwise, any ready thread is returned.
+///
+/// Side effect: the returned thread is removed from the ready list.
+Thread *
+Scheduler::FindNextToYieldTo(Thread *current)
+{
+    ASSERT(current != nullptr);
 
-    // If no thread is found, there are no ready threads and nullptr is returned
-    return nullptr;
+    if(policy == SCHED_FEEDBACK){
+        if(stats->totalTicks >= nextBoost)
+            Boost();
+        Charge(current);
+
+        if(readyLevels == 0
+             || 31 - __builtin_clz(readyLevels) < current->GetPriority())
+            return nullptr;
+    } else if(policy == SCHED_STRIDE){
+        Charge(current);
+
+        if(readyHead[0] == nullptr || readyHead[0]->pass >= current->pass)
+            return nullptr;
+    }
+    return FindNextToRun();
 }
 
 /// Dispatch the CPU to `nextThread`.
@@ -100,6 +217,12 @@ Scheduler::Run(Thread *nextThread)
     oldThread->CheckOverflow();  // Check if the old thread had an undetected
                                  // stack overflow.
 
+    if(oldThread->GetStatus() != READY)
+        Charge(oldThread);
+    nextThread->sliceStart = stats->totalTicks;
+    if(policy == SCHED_STRIDE)
+        virtualPass = nextThread->pass;
+
     currentThread = nextThread;  // Switch to the next thread.
     currentThread->SetStatus(RUNNING);  // `nextThread` is now running.
 
@@ -150,11 +273,12 @@ Scheduler::Print()
     printf("Ready list contents:\n");
     for(int i = priorityAmount - 1; i >= 0; i--){
         // If the list is empty, there is nothing to print
-        if(readyList[i]->IsEmpty())
+        if(readyHead[i] == nullptr)
             continue;
 
         printf("Priority %d\n", i);
-        readyList[i]->Apply(ThreadPrint);
+        for(Thread *t = readyHead[i]; t != nullptr; t = t->nextReady)
+            ThreadPrint(t);
     }
 }
 
@@ -167,10 +291,167 @@ Scheduler::GetPriorityAmount() const
 void
 Scheduler::PromoteThread(Thread *promoted, int newPriority)
 {
+    ASSERT(newPriority >= 0 and newPriority < priorityAmount);
+
+    // Only a thread in a ready queue has to move to another one, and stride
+    // scheduling does not look at priorities.
+    if(promoted->GetStatus() != READY || policy == SCHED_STRIDE){
+        promoted->SetPriority(newPriority);
+        return;
+    }
+
     // Remove the thread from the old queue
-    readyList[promoted->GetPriority()]->Remove(promoted);
+    Dequeue(promoted);
 
     // Change the priority and push it to the corresponding queue
     promoted->SetPriority(newPriority);
-    ReadyToRun(promoted);
+    Enqueue(promoted);
+}
+
+void
+Scheduler::SetFeedback(const unsigned *quanta, unsigned count,
+                       unsigned boostPeriod_)
+{
+    ASSERT(quanta != nullptr);
+    ASSERT(count > 0);
+    ASSERT(boostPeriod_ > 0);
+
+    for(int i = 0; i < priorityAmount; i++){
+        unsigned q = quanta[(unsigned) i < count ? i : count - 1];
+        ASSERT(q > 0);
+        quantum[priorityAmount - 1 - i] = q;
+    }
+    boostPeriod = boostPeriod_;
+    nextBoost = stats->totalTicks + boostPeriod;
+    policy = SCHED_FEEDBACK;
+}
+
+void
+Scheduler::SetStride()
+{
+    ASSERT(readyLevels == 0);
+
+    policy = SCHED_STRIDE;
+}
+
+void
+Scheduler::SetTickets(Thread *thread, unsigned tickets)
+{
+    ASSERT(thread != nullptr);
+    ASSERT(tickets > 0 && tickets <= MAX_TICKETS);
+
+    DEBUG('t', "Giving %u tickets to thread %s\n", tickets, thread->GetName());
+    thread->tickets = tickets;
+}
+
+int
+Scheduler::InitialPriority(int requested) const
+{
+    return policy == SCHED_FEEDBACK ? priorityAmount - 1 : requested;
+}
+
+void
+Scheduler::WaitForDevice(Semaphore *done)
+{
+    ASSERT(done != nullptr);
+
+    currentThread->waitingIO = true;
+    done->P();
+    currentThread->waitingIO = false;
+}
+
+bool
+Scheduler::ShouldPreempt(Thread *current)
+{
+    ASSERT(current != nullptr);
+
+    // Nothing to switch to: stop interrupting the running thread for
+    // nothing, until ReadyToRun gives it company.
+    if(readyLevels == 0){
+        if(!slicingStopped){
+            DEBUG('t', "No thread ready, stopping time slicing\n");
+            slicingStopped = true;
+            if(timer != nullptr)
+                timer->Stop();
+            if(preemptiveScheduler != nullptr)
+                preemptiveScheduler->Stop();
+        }
+        return false;
+    }
+
+    unsigned slice = current->GetTimeSlice();
+    return slice == 0 || stats->totalTicks - current->sliceStart >= slice;
+}
+
+void
+Scheduler::SetDefaultTimeSlice(unsigned ticks)
+{
+    defaultTimeSlice = ticks;
+}
+
+unsigned
+Scheduler::GetDefaultTimeSlice() const
+{
+    return defaultTimeSlice;
+}
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    unsigned long long now = stats->totalTicks;
+    unsigned used = now - thread->sliceStart;
+    thread->sliceStart = now;
+
+    if(policy == SCHED_STRIDE){
+        thread->pass += (unsigned long long) used * (STRIDE1 / thread->tickets);
+        return;
+    }
+    if(policy != SCHED_FEEDBACK)
+        return;
+
+    thread->levelTicks += used;
+    if(thread->boostCount != boostCount){
+        Raise(thread);
+        return;
+    }
+
+    int level = thread->GetBasePriority();
+    if(thread->levelTicks >= quantum[level]){
+        thread->levelTicks = 0;
+        if(level > 0){
+            DEBUG('t', "Demoting thread %s to priority %d\n",
+                  thread->GetName(), level - 1);
+            thread->SetBasePriority(level - 1);
+        }
+    }
+}
+
+void
+Scheduler::Raise(Thread *thread)
+{
+    thread->SetBasePriority(priorityAmount - 1);
+    thread->levelTicks = 0;
+    thread->boostCount = boostCount;
+}
+
+void
+Scheduler::Boost()
+{
+    DEBUG('t', "Boosting every thread to priority %d\n", priorityAmount - 1);
+
+    boostCount++;
+    nextBoost = stats->totalTicks + boostPeriod;
+
+    int top = priorityAmount - 1;
+    for(Thread *t = readyHead[top]; t != nullptr; t = t->nextReady){
+        t->levelTicks = 0;
+        t->boostCount = boostCount;
+    }
+    for(int i = top - 1; i >= 0; i--)
+        while(readyHead[i] != nullptr){
+            Thread *t = readyHead[i];
+            Dequeue(t);
+            Raise(t);
+            Enqueue(t);
+        }
 }
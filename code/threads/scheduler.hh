@@ -12,17 +12,37 @@
 
 
 #include "thread.hh"
-#include "lib/list.hh"
 
 
+class Semaphore;
+
+/// Largest number of priority levels: one bit of a word for each.
+const int MAX_PRIORITY_LEVELS = 32;
+
+/// Number of priority levels unless set with `-pl`.
+const int DEFAULT_PRIORITY_LEVELS = 10;
+
+/// Tickets a thread holds for stride scheduling unless given others.
+const unsigned DEFAULT_TICKETS = 100;
+
+/// Most tickets a thread can hold.
+const unsigned MAX_TICKETS = 1 << 16;
+
+/// Ways of choosing the next thread to run.
+enum SchedulingPolicy {
+    SCHED_PRIORITY,  ///< Highest priority first, as set by each thread.
+    SCHED_FEEDBACK,  ///< Priorities adjusted by the use of the CPU.
+    SCHED_STRIDE     ///< Share of the CPU proportional to tickets.
+};
+
 /// The following class defines the scheduler/dispatcher abstraction --
 /// the data structures and operations needed to keep track of which
 /// thread is running, and which threads are ready but not running.
 class Scheduler {
 public:
 
-    /// Initialize list of ready threads.
-    Scheduler();
+    /// Initialize list of ready threads, with `levels` priorities.
+    Scheduler(int levels = DEFAULT_PRIORITY_LEVELS);
 
     /// De-allocate ready list.
     ~Scheduler();
@@ -33,6 +53,11 @@ public:
     /// Dequeue first thread on the ready list, if any, and return thread.
     Thread *FindNextToRun();
 
+    /// Dequeue the thread that should run instead of `current`, which
+    /// offers to yield, and return it.  Return null if `current` should
+    /// keep running.
+    Thread *FindNextToYieldTo(Thread *current);
+
     /// Cause `nextThread` to start running.
     void Run(Thread *nextThread);
 
@@ -46,12 +71,99 @@ public:
     // Returns the maximum level of priority a thread can have
     const int GetPriorityAmount() const;
 
+    // Switches to multilevel feedback scheduling. Threads start at the
+    // highest priority, and go down one level whenever they use up the
+    // quantum of their level. quanta holds count quanta in ticks, from the
+    // highest level down; the last one also applies to the levels below.
+    // Threads woken up by a device go back to the highest level, and so do
+    // all threads every boostPeriod ticks. Quanta are enforced whenever the
+    // running thread is preempted: by the timer, or by the preemptive
+    // scheduler for kernel threads.
+    void SetFeedback(const unsigned *quanta, unsigned count,
+                     unsigned boostPeriod);
+
+    // Switches to stride scheduling. Every thread gets a share of the CPU
+    // proportional to its tickets, measured in ticks, regardless of its
+    // priority: each tick a thread runs advances its pass by a stride
+    // inversely proportional to its tickets, and the ready thread with the
+    // lowest pass always runs next.
+    void SetStride();
+
+    // Gives tickets tickets to thread, for stride scheduling.
+    void SetTickets(Thread *thread, unsigned tickets);
+
+    // Returns the priority that a new thread asking for requested gets.
+    int InitialPriority(int requested) const;
+
+    // Puts the current thread to sleep on done, which a device signals when
+    // a request completes.
+    void WaitForDevice(Semaphore *done);
+
+    // Called on every timer interrupt, or forced context switch of the
+    // preemptive scheduler. Returns whether current should yield the CPU:
+    // only once it has run for its time slice, and if another thread is
+    // ready. With no thread ready, time slicing is stopped, to start again
+    // when one becomes ready.
+    bool ShouldPreempt(Thread *current);
+
+    // Sets the time slice, in ticks, that new threads get. Zero, the
+    // default, lets a thread be preempted on every timer interrupt or
+    // forced context switch.
+    void SetDefaultTimeSlice(unsigned ticks);
+
+    unsigned GetDefaultTimeSlice() const;
+
 private:
     // Amount of levels of priority that can be assigned to threads.
-    static const int priorityAmount = 10;
+    int priorityAmount;
+
+    // Queues of threads that are ready to run, but not running, one for
+    // each priority. They are linked through the threads themselves, so
+    // queueing never allocates.
+    Thread *readyHead[MAX_PRIORITY_LEVELS];
+    Thread *readyTail[MAX_PRIORITY_LEVELS];
+
+    // Bit i is set iff the queue of priority i is not empty, so that the
+    // highest non-empty queue is found in a single instruction.
+    unsigned readyLevels;
+
+    // Append thread to the queue of its priority.
+    void Enqueue(Thread *thread);
+
+    // Unlink thread from the queue of its priority.
+    void Dequeue(Thread *thread);
+
+    SchedulingPolicy policy;
+
+    // Multilevel feedback state; see SetFeedback.
+    unsigned quantum[MAX_PRIORITY_LEVELS];
+    unsigned boostPeriod;
+    unsigned long long nextBoost;
+
+    // Number of periodic boosts so far. Threads that were not ready at the
+    // time catch up when they are next charged or woken up.
+    unsigned boostCount;
+
+    unsigned defaultTimeSlice;
+
+    // Whether time slicing was stopped because no thread was ready.
+    bool slicingStopped;
+
+    // Stride scheduling state: the pass of the thread last dispatched,
+    // which threads joining the competition start from, so that time spent
+    // blocked is not made up for.
+    unsigned long long virtualPass;
+
+    // Charges thread for the ticks it ran since it was last charged: adds
+    // them to its level, and demotes it if it used up its quantum, or
+    // advances its pass. thread must not be in a ready queue.
+    void Charge(Thread *thread);
+
+    // Moves thread, which is not in a ready queue, to the highest level.
+    void Raise(Thread *thread);
 
-    // Queue of threads that are ready to run, but not running.
-    List<Thread*> *readyList[priorityAmount];
+    // Moves every thread to the highest level.
+    void Boost();
 
 };
 
@@ -51,6 +51,7 @@ Bitmap *pageMap;
 TLB_Handler *tlb_handler;
     #ifdef DEMAND_LOADING
         CoreMap *coreMap;
+        SwapManager *swapManager;
         unsigned int swapCount;
     #endif
 #endif
@@ -77,12 +78,19 @@ extern void Cleanup();
 /// done, it will appear as if the interrupted thread called Yield at the
 /// point it is was interrupted.
 ///
+/// The scheduler only asks for the context switch once the interrupted
+/// thread used up its time slice, and stops the timer while no other thread
+/// is ready.
+///
 /// * `dummy` is because every interrupt handler takes one argument, whether
 ///   it needs it or not.
 static void
 TimerInterruptHandler(void *dummy)
 {
-    if (interrupt->GetStatus() != IDLE_MODE)
+    // Asking the scheduler even when idle lets it stop the timer if no
+    // thread is ready.
+    if (scheduler->ShouldPreempt(currentThread)
+          && interrupt->GetStatus() != IDLE_MODE)
         interrupt->YieldOnReturn();
 }
 
@@ -111,10 +119,31 @@ Initialize(int argc, char **argv)
     bool preemptiveScheduling = false;
     long long timeSlice;
 
+    int priorityLevels = DEFAULT_PRIORITY_LEVELS;
+    unsigned feedbackQuanta[MAX_PRIORITY_LEVELS];
+    unsigned feedbackLevels = 0;  // No feedback scheduling if zero.
+    unsigned boostPeriod = 0;
+    bool strideScheduling = false;
+    unsigned threadTimeSlice = 0;  // Preempt on every interrupt if zero.
+
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
     threadTable = new Table<Thread*>();
 #endif
+#ifdef USE_TLB
+    unsigned tlbEntries = TLB_SIZE;  // TLB geometry, fully associative by
+    unsigned tlbWays = TLB_SIZE;     // default.
+    TLBPolicy tlbPolicy = TLB_FIFO;  // TLB replacement policy.
+#endif
+#ifdef DEMAND_LOADING
+#ifdef LRU
+    PagePolicy pagePolicy = PAGE_LRU;  // Page replacement policy.
+#else
+    PagePolicy pagePolicy = PAGE_FIFO;
+#endif
+    unsigned pagerLow = 0;   // Free frame watermarks for the pager thread;
+    unsigned pagerHigh = 0;  // no pager if zero.
+#endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
 #endif
@@ -148,11 +177,64 @@ Initialize(int argc, char **argv)
                 timeSlice = atoi(*(argv+1));
                 argCount = 2;
             }
+        } else if (!strcmp(*argv, "-pl")) {
+            ASSERT(argc > 1);
+            priorityLevels = atoi(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-fq")) {
+            ASSERT(argc > 2);
+            // Comma-separated quanta, from the highest level down.
+            const char *q = *(argv + 1);
+            for (feedbackLevels = 0; *q != '\0'; feedbackLevels++) {
+                ASSERT(feedbackLevels < MAX_PRIORITY_LEVELS);
+                char *end;
+                feedbackQuanta[feedbackLevels] = strtoul(q, &end, 10);
+                ASSERT(end != q && (*end == ',' || *end == '\0'));
+                q = *end == ',' ? end + 1 : end;
+            }
+            boostPeriod = atoi(*(argv + 2));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-st"))
+            strideScheduling = true;
+        else if (!strcmp(*argv, "-ts")) {
+            ASSERT(argc > 1);
+            threadTimeSlice = atoi(*(argv + 1));
+            argCount = 2;
         }
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
 #endif
+#ifdef USE_TLB
+        if (!strcmp(*argv, "-tlb")) {
+            ASSERT(argc > 2);
+            tlbEntries = atoi(*(argv + 1));
+            tlbWays = atoi(*(argv + 2));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-tlbp")) {
+            ASSERT(argc > 1);
+            if (!TLB_Handler::PolicyFromName(*(argv + 1), &tlbPolicy)) {
+                fprintf(stderr, "Unknown TLB policy %s\n", *(argv + 1));
+                ASSERT(false);
+            }
+            argCount = 2;
+        }
+#endif
+#ifdef DEMAND_LOADING
+        if (!strcmp(*argv, "-pp")) {
+            ASSERT(argc > 1);
+            if (!CoreMap::PolicyFromName(*(argv + 1), &pagePolicy)) {
+                fprintf(stderr, "Unknown page policy %s\n", *(argv + 1));
+                ASSERT(false);
+            }
+            argCount = 2;
+        } else if (!strcmp(*argv, "-pd")) {
+            ASSERT(argc > 2);
+            pagerLow = atoi(*(argv + 1));
+            pagerHigh = atoi(*(argv + 2));
+            argCount = 3;
+        }
+#endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = true;
@@ -173,7 +255,13 @@ Initialize(int argc, char **argv)
     debug.SetFlags(debugArgs);  // Initialize `DEBUG` messages.
     stats = new Statistics;     // Collect statistics.
     interrupt = new Interrupt;  // Start up interrupt handling.
-    scheduler = new Scheduler;  // Initialize the ready queue.
+    scheduler = new Scheduler(priorityLevels);  // Initialize the ready
+                                                // queue.
+    if (feedbackLevels > 0)
+        scheduler->SetFeedback(feedbackQuanta, feedbackLevels, boostPeriod);
+    else if (strideScheduling)
+        scheduler->SetStride();
+    scheduler->SetDefaultTimeSlice(threadTimeSlice);
     if (randomYield)            // Start the timer (if needed).
         timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -206,9 +294,16 @@ Initialize(int argc, char **argv)
     #endif
 
 	#ifdef VMEM
-		tlb_handler = new TLB_Handler;
+        #ifdef USE_TLB
+            machine->GetMMU()->ConfigureTLB(tlbEntries, tlbWays);
+            tlb_handler = new TLB_Handler(tlbPolicy);
+        #else
+		    tlb_handler = new TLB_Handler;
+        #endif
         #ifdef DEMAND_LOADING
-	       coreMap = new CoreMap;
+	       coreMap = new CoreMap(pagePolicy);
+	       if (pagerHigh != 0)
+	           coreMap->StartPager(pagerLow, pagerHigh);
         #endif
 	#endif
 
@@ -223,6 +318,10 @@ Initialize(int argc, char **argv)
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef DEMAND_LOADING
+    swapManager = new SwapManager;  // Needs the file system.
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
@@ -250,6 +349,7 @@ Cleanup()
         delete tlb_handler;
         #ifdef DEMAND_LOADING
             delete  coreMap;
+            delete  swapManager;
         #endif
     #endif
 #endif
@@ -11,6 +11,7 @@
 
 #include "thread.hh"
 #include "scheduler.hh"
+#include "preemptive.hh"
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
@@ -33,6 +34,8 @@ extern Scheduler *scheduler;         ///< The ready list.
 extern Interrupt *interrupt;         ///< Interrupt status.
 extern Statistics *stats;            ///< Performance metrics.
 extern Timer *timer;                 ///< The hardware alarm clock.
+extern PreemptiveScheduler *preemptiveScheduler;  ///< Time slicing of kernel
+                                                  ///< threads, if enabled.
 
 #ifdef USER_PROGRAM
 #include "machine/machine.hh"
@@ -44,7 +47,9 @@ extern Bitmap *pageMap;
 #ifdef VMEM
     #ifdef DEMAND_LOADING
     #include "vmem/coremap.hh"
+    #include "vmem/swap_manager.hh"
     extern CoreMap *coreMap;
+    extern SwapManager *swapManager;
     extern unsigned int swapCount;
     #endif
 #include "vmem/tlb_handler.hh"
@@ -48,8 +48,8 @@ Thread::Thread(const char *threadName, bool enableJoin_, int priority_)
 
     // Check that the priority is valid
     ASSERT(priority_ >= 0 and priority_ < scheduler->GetPriorityAmount());
-    priority   = priority_;
-    oldPriority = priority_;
+    priority   = scheduler->InitialPriority(priority_);
+    oldPriority = priority;
 
     // The Join Port only is initialized if Join is enabled on the thread
     if(enableJoin){
@@ -62,6 +62,15 @@ Thread::Thread(const char *threadName, bool enableJoin_, int priority_)
     stackTop   = nullptr;
     stack      = nullptr;
     status     = JUST_CREATED;
+    nextReady  = nullptr;
+    prevReady  = nullptr;
+    sliceStart = 0;
+    levelTicks = 0;
+    boostCount = 0;
+    waitingIO  = false;
+    timeSlice  = scheduler->GetDefaultTimeSlice();
+    tickets    = DEFAULT_TICKETS;
+    pass       = 0;
 #ifdef USER_PROGRAM
     space      = nullptr;
 
@@ -70,7 +79,6 @@ Thread::Thread(const char *threadName, bool enableJoin_, int priority_)
     fileTable  = new Table<OpenFile*>();
     for(int i = 0; i < tableReserved; i++)
         fileTable -> Add(nullptr);
-    maxFileTableInd = 0;
 
     // Add this thread to the userprog thread table (declared in system.cc)
     spaceId = threadTable -> Add(this);
@@ -183,6 +191,12 @@ Thread::SetStatus(ThreadStatus st)
     status = st;
 }
 
+ThreadStatus
+Thread::GetStatus() const
+{
+    return status;
+}
+
 char *
 Thread::GetName()
 {
@@ -219,6 +233,32 @@ Thread::RestorePriority()
     priority = oldPriority;
 }
 
+void
+Thread::SetBasePriority(int newPriority)
+{
+    if(priority == oldPriority || newPriority > priority)
+        priority = newPriority;
+    oldPriority = newPriority;
+}
+
+int
+Thread::GetBasePriority() const
+{
+    return oldPriority;
+}
+
+void
+Thread::SetTimeSlice(unsigned ticks)
+{
+    timeSlice = ticks;
+}
+
+unsigned
+Thread::GetTimeSlice() const
+{
+    return timeSlice;
+}
+
 #ifdef USER_PROGRAM
 
 /// Adds a OpenFile pointer to the table and returns the
@@ -226,12 +266,7 @@ Thread::RestorePriority()
 int
 Thread::AddFile(OpenFile *filePtr)
 {
-    int possibleFileId = fileTable -> Add(filePtr);
-
-    if(possibleFileId != -1)
-        maxFileTableInd = maxx(maxFileTableInd, SpaceId(possibleFileId));
-
-    return possibleFileId;
+    return fileTable -> Add(filePtr);
 }
 
 /// Returns the OpenFile pointer stored at index fileId.
@@ -246,8 +281,7 @@ Thread::GetFile(OpenFileId fileId)
 bool
 Thread::HasFile(OpenFileId fileId)
 {
-    bool found = fileTable -> HasKey(fileId);
-    return found;
+    return fileId >= 0 && fileTable -> HasKey(fileId);
 }
 
 /// Removes the file corresponding to the fileId.
@@ -262,9 +296,9 @@ Thread::RemoveFile(OpenFileId fileId)
 void
 Thread::RemoveAllFiles()
 {
-    for(int ind = tableReserved; ind <= maxFileTableInd; ind++)
-        if(fileTable -> HasKey(ind))
-            RemoveFile(ind);
+    for(int ind = fileTable -> NextKey(tableReserved - 1); ind != -1;
+        ind = fileTable -> NextKey(ind))
+        RemoveFile(ind);
 }
 
 /// Returns the SpaceId of the current process
@@ -344,7 +378,7 @@ Thread::Yield()
 
     DEBUG('t', "Yielding thread \"%s\"\n", GetName());
 
-    Thread *nextThread = scheduler->FindNextToRun();
+    Thread *nextThread = scheduler->FindNextToYieldTo(this);
     if (nextThread != nullptr) {
         scheduler->ReadyToRun(this);
         scheduler->Run(nextThread);
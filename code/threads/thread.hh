@@ -104,6 +104,28 @@ private:
     // Original thread priority (the one assigned when the object is created).
     int oldPriority;
 
+    // Links of the ready queue of the scheduler, while the thread is in it.
+    friend class Scheduler;
+    Thread *nextReady;
+    Thread *prevReady;
+
+    // Multilevel feedback accounting, kept by the scheduler: when the
+    // thread was last dispatched or charged, ticks used at its current
+    // level, periodic boosts it has seen, and whether it is waiting for a
+    // device.
+    unsigned long long sliceStart;
+    unsigned levelTicks;
+    unsigned boostCount;
+    bool waitingIO;
+
+    // Ticks the thread runs for before it can be preempted, or zero to be
+    // preempted on every timer interrupt.
+    unsigned timeSlice;
+
+    // Stride scheduling: tickets held, and virtual time consumed so far.
+    unsigned tickets;
+    unsigned long long pass;
+
     // Signals if Join can be called on this thread.
     bool enableJoin;
 
@@ -119,7 +141,6 @@ private:
     // There are two reserved entries reserved for synchConsole
     // in the table, 0 and 1.
     Table <OpenFile*> *fileTable;
-    int maxFileTableInd;
     const int tableReserved = 2;
     SpaceId spaceId;
 
@@ -161,12 +182,26 @@ public:
 
     void SetStatus(ThreadStatus st);
 
+    ThreadStatus GetStatus() const;
+
     // Changes the priority of the thread to newPriority
     void SetPriority(int newPriority);
 
     // Changes the priority of the thread to its original value
     void RestorePriority();
 
+    // Changes the original priority of the thread to newPriority. A higher
+    // priority it was promoted to is kept until RestorePriority.
+    void SetBasePriority(int newPriority);
+
+    // Returns the original priority of the thread.
+    int GetBasePriority() const;
+
+    // Sets the ticks the thread runs for before it can be preempted.
+    void SetTimeSlice(unsigned ticks);
+
+    unsigned GetTimeSlice() const;
+
 #ifdef USER_PROGRAM
     // Adds a OpenFile pointer to the table and returns the
     // index where it is stored, or -1 if not successful.
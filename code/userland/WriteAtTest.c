@@ -19,8 +19,9 @@ main(void)
 
 		OpenFileId o = Open("../userland/WriteAtTest.txt");
 		char aux[64];
-		Read(aux, 64, o);
-		Write(aux, 64, CONSOLE_OUTPUT);
+		int n = Read(aux, 64, o);
+		if (n > 0)
+		    Write(aux, n, CONSOLE_OUTPUT);
 
 		Halt();
     // Not reached.
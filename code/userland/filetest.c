@@ -19,8 +19,9 @@ main(void)
     Close(o);
     o = Open("test.txt");
     char aux[64];
-    Read(aux, 64, o);
-    Write(aux, 64, CONSOLE_OUTPUT);
+    int n = Read(aux, 64, o);
+    if (n > 0)
+        Write(aux, n, CONSOLE_OUTPUT);
 
     // Read(aux, 64, CONSOLE_INPUT);
     // Write("Hello World", 12, CONSOLE_OUTPUT);
@@ -83,6 +83,22 @@ Yield:
         j       $31
         .end    Yield
 
+        .globl  Tickets
+        .ent    Tickets
+Tickets:
+        addiu   $2, $0, SC_TICKETS
+        syscall
+        j       $31
+        .end    Tickets
+
+        .globl  TimeSlice
+        .ent    TimeSlice
+TimeSlice:
+        addiu   $2, $0, SC_SLICE
+        syscall
+        j       $31
+        .end    TimeSlice
+
         .globl  Create
         .ent    Create
 Create:
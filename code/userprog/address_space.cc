@@ -69,6 +69,7 @@ AddressSpace::AddressSpace(OpenFile *executable, SpaceId spaceId_)
     ASSERT(executable != nullptr);
 
     spaceId = spaceId_;
+    asid = NUM_ASIDS;
 
     noffHeader noffH;
     executable->ReadAt((char *) &noffH, sizeof noffH, 0);
@@ -117,9 +118,11 @@ AddressSpace::AddressSpace(OpenFile *executable, SpaceId spaceId_)
           // If the code segment was entirely on a separate page, we could
           // set its pages to be read-only.
 
-        //Zero out the page.
+        // Zero out the page, unless the executable fills all of it below.
         unsigned pageIndex = pageTable[i].physicalPage;
-		memset(mainMemory + pageIndex * PAGE_SIZE, 0, PAGE_SIZE);
+        if(BackedBytes(i) < PAGE_SIZE)
+		    memset(mainMemory + pageIndex * PAGE_SIZE, 0, PAGE_SIZE);
+        machine -> GetMMU() -> InvalidateDecodedPage(pageIndex);
     }
 
     // Then, copy in the code and data segments into memory.
@@ -186,16 +189,16 @@ AddressSpace::AddressSpace(OpenFile *executable, SpaceId spaceId_)
 
     #else
 
-    // Fits SWAP.asid where asid is a SpaceId of up to 10 digits.
-    swapFileName = new char [16];
-    snprintf(swapFileName, 16, "SWAP.%i", spaceId);
-
-    // Create a swap file for this thread and store its OpenFile pointer in
-    // swapFile.
-    fileSystem -> Create(swapFileName, 0);
-    swapFile = fileSystem -> Open(swapFileName);
-
+    // Swap slots are allocated on the first eviction of each page.
+    swapSlot = new int [numPages];
+    swapWritten = new bool [numPages];
+    fileId = executable -> GetFileId();
+    faultAround = 0;
+    nextSequentialPage = 0;
     for (unsigned i = 0; i < numPages; i++) {
+        swapSlot[i] = -1;
+        swapWritten[i] = false;
+
         ///Using an invalid value for virtual pages to know when
         /// a page has not yet been loaded.
         pageTable[i].virtualPage  = numPages;
@@ -216,15 +219,21 @@ AddressSpace::AddressSpace(OpenFile *executable, SpaceId spaceId_)
 /// Nothing for now!
 AddressSpace::~AddressSpace()
 {
+    #ifdef USE_TLB
+        tlb_handler -> ReleaseSpace(this);
+    #endif
+
     #ifndef DEMAND_LOADING
 	for(unsigned i = 0; i < numPages; i++)
 		pageMap -> Clear(pageTable[i].physicalPage);
 
     #else
         coreMap -> ReleasePages(this);
-        delete swapFile;
-        fileSystem -> Remove(swapFileName);
-        delete [] swapFileName;
+        for(unsigned i = 0; i < numPages; i++)
+            if(swapSlot[i] != -1)
+                swapManager -> FreeSlot(swapSlot[i]);
+        delete [] swapSlot;
+        delete [] swapWritten;
     #endif
     delete [] pageTable;
     delete ourExecutable;
@@ -264,8 +273,9 @@ AddressSpace::SaveState()
 {
     #ifdef USE_TLB
     TranslationEntry *tlbRef = machine -> GetMMU() -> tlb;
-	for(unsigned i = 0; i < TLB_SIZE; i++){
-        if(tlbRef[i].valid){
+    unsigned tlbSize = machine -> GetMMU() -> GetTLBSize();
+	for(unsigned i = 0; i < tlbSize; i++){
+        if(tlbRef[i].valid && tlbRef[i].asid == asid){
             unsigned pageIndex = tlbRef[i].virtualPage;
             pageTable[pageIndex].use = tlbRef[i].use;
             pageTable[pageIndex].dirty = tlbRef[i].dirty;
@@ -282,14 +292,15 @@ void
 AddressSpace::RestoreState()
 {
 	#ifdef USE_TLB
-        // Invalidate previous TLB entries.
-        TranslationEntry *tlbRef = machine -> GetMMU() -> tlb;
-    	for(unsigned i = 0; i < TLB_SIZE; i++)
-    		tlbRef[i].valid = false;
+        // Entries of other address spaces stay in the TLB, tagged with
+        // their ASIDs, so there is nothing to invalidate here.
+        tlb_handler -> ActivateSpace(this);
     #else
 
     machine->GetMMU()->pageTable     = pageTable;
     machine->GetMMU()->pageTableSize = numPages;
+    // Cached translations come from the previous page table.
+    machine->GetMMU()->FlushTranslations();
 
 	#endif
 }
@@ -313,32 +324,94 @@ AddressSpace::FindContainingPageIndex (int vAddr)
 
 #ifdef DEMAND_LOADING
 
-// Stores the page in the swap file.
-void
+// Removes the page from memory, storing it in the swap file only if it was
+// modified since it was loaded. Returns false, leaving it in memory, if
+// that is needed and the swap area is full.
+bool
 AddressSpace::SwapPage(unsigned int pageIndex)
 {
-    // Write the page to the swap file.
-    unsigned int physStart = pageTable[pageIndex].physicalPage * PAGE_SIZE;
-    char *mainMemory = machine -> GetMMU() -> mainMemory;
-    swapFile -> WriteAt(&mainMemory[physStart], PAGE_SIZE, pageIndex*PAGE_SIZE);
+    // Invalidate the corresponding tlb entry (if it exists). It may be there
+    // even if this is not the current address space, tagged with our ASID.
+    // This also brings its dirty flag up to date.
+    #ifdef USE_TLB
+        tlb_handler -> DropPage(this, pageIndex);
+    #endif
 
-    // Zero out the page in memory.
-    memset(&mainMemory[physStart], 0, PAGE_SIZE);
+    // The frame is not zeroed here: whoever gets it next overwrites it, or
+    // zeroes it if it is for a zero-fill page.
+
+    // Write the page to its swap slot, unless the copy it was loaded from
+    // (the swap area or the executable) is still good.
+    if(pageTable[pageIndex].dirty && !WriteSwapSlot(pageIndex))
+        return false;
+
+    machine -> GetMMU() ->
+        InvalidateDecodedPage(pageTable[pageIndex].physicalPage);
 
     // Update the pageTable.
-    // numPages + 1 means the page is currently in the swap file.
-    pageTable[pageIndex].virtualPage = numPages + 1;
-
-    // Invalidate the corresponding tlb entry (if it exists). This only happens
-    // if the page belongs to the current thread.
-    if(currentThread -> GetAddressSpace() == this){
-        unsigned int swappedInd = pageTable[pageIndex].physicalPage;
-        TranslationEntry *tlb = machine -> GetMMU() -> tlb;
-
-        for(unsigned int tlbInd = 0; tlbInd < TLB_SIZE; tlbInd++)
-            if(tlb[tlbInd].physicalPage == swappedInd)
-                tlb[tlbInd].valid = false;
+    // numPages + 1 means the page is currently in the swap file, and
+    // numPages that it must be loaded from the executable again.
+    pageTable[pageIndex].virtualPage = swapWritten[pageIndex]
+                                       ? numPages + 1 : numPages;
+    return true;
+}
+
+// Writes the page to its swap slot if it was modified, and marks it clean,
+// leaving it in memory. Returns whether it was written; it is not if the
+// swap area is full.
+bool
+AddressSpace::CleanPage(unsigned int pageIndex)
+{
+    // The flags are cleared before writing, so that a write to the page
+    // while the copy is going on marks it dirty again.
+    bool dirty = pageTable[pageIndex].dirty;
+    pageTable[pageIndex].dirty = false;
+    #ifdef USE_TLB
+        if(tlb_handler -> TestAndClearDirty(this, pageIndex))
+            dirty = true;
+    #endif
+    if(!dirty)
+        return false;
+
+    if(!WriteSwapSlot(pageIndex)){
+        pageTable[pageIndex].dirty = true;
+        return false;
+    }
+    return true;
+}
+
+// Writes the page to its swap slot, setting one aside first if it has none.
+// Returns false if the swap area is full.
+bool
+AddressSpace::WriteSwapSlot(unsigned int pageIndex)
+{
+    // Set slots aside for the whole cluster in a row, unless some page of
+    // it already has one, or there is no such run. Then the page gets a
+    // slot of its own.
+    if(swapSlot[pageIndex] == -1){
+        unsigned first = pageIndex - pageIndex % SWAP_CLUSTER;
+        unsigned count = minn(SWAP_CLUSTER, numPages - first);
+        int slot = -1;
+        bool clusterFree = true;
+        for(unsigned i = first; i < first + count; i++)
+            if(swapSlot[i] != -1)
+                clusterFree = false;
+        if(clusterFree)
+            slot = swapManager -> AllocateSlots(count);
+        if(slot != -1)
+            for(unsigned i = 0; i < count; i++)
+                swapSlot[first + i] = slot + i;
+        else if((swapSlot[pageIndex] = swapManager -> AllocateSlot()) == -1)
+            return false;
     }
+
+    unsigned int physStart = pageTable[pageIndex].physicalPage * PAGE_SIZE;
+    char *mainMemory = machine -> GetMMU() -> mainMemory;
+
+    swapManager -> WriteSlot(swapSlot[pageIndex], &mainMemory[physStart]);
+    swapWritten[pageIndex] = true;
+    stats -> numSwapWrites++;
+    return true;
 }
 #endif
 
@@ -352,111 +425,321 @@ AddressSpace::NotLoadedPage (unsigned pageIndex)
 }
 
 // Loads a page to the main memory, iff it isn't already loaded.
-// (if it is, it does nothing).
-void
+// (if it is, it does nothing). Returns false if no frame could be freed for
+// it, because the swap area is full.
+bool
 AddressSpace::LoadPage(unsigned int pageIndex) {
     int physIndex;
     #ifdef DEMAND_LOADING
+         // The page may already be in memory, loaded by another address
+         // space running the same executable.
+         if(pageTable[pageIndex].virtualPage == numPages
+              && IsSharedPage(pageIndex)){
+             int sharedIndex = coreMap -> FindSharedPage(fileId, pageIndex);
+             if(sharedIndex != -1){
+                 coreMap -> JoinSharedPage(sharedIndex, this);
+                 pageTable[pageIndex].virtualPage = pageIndex;
+                 pageTable[pageIndex].physicalPage = sharedIndex;
+                 pageTable[pageIndex].readOnly = true;
+                 pageTable[pageIndex].use = false;
+                 pageTable[pageIndex].dirty = false;
+                 stats -> numSharedPages++;
+                 return true;
+             }
+         }
+
          // Reserve a physical page using coreMap.
          physIndex = coreMap -> ReservePage(pageIndex);
+         if(physIndex == -1)
+             return false;
          pageTable[pageIndex].physicalPage = physIndex;
+
+         // Loading may block under the file system, and other threads may
+         // run and look for victims meanwhile, so the frames stay pinned
+         // until the page table entries are final.
+         coreMap -> PinPage(physIndex);
     #else
         // This happens only if demand loading is enabled and swap is disabled.
         physIndex = pageTable[pageIndex].physicalPage;
     #endif
 
-    // If the page was never loaded to memory.
-    if(pageTable[pageIndex].virtualPage == numPages)
-        LoadPageFirst(pageIndex, physIndex);
-    // If the page is in the swap file.
+    // The frame is about to get new contents, so any instruction decoded
+    // from it is stale.
+    machine -> GetMMU() -> InvalidateDecodedPage(physIndex);
+
     #ifdef DEMAND_LOADING
-    else if(pageTable[pageIndex].virtualPage == numPages + 1)
-        LoadPageSwap(pageIndex, physIndex);
+        // Pages of the uninitialized data and the stack never loaded before
+        // are zero-fill: they need no I/O, so they are not worth loading
+        // ahead of time. They do not count as sequential accesses either.
+        bool zeroFill = pageTable[pageIndex].virtualPage == numPages
+                        && BackedBytes(pageIndex) == 0;
+
+        // Fault around: while faults keep landing right after the pages
+        // brought in by the previous one, double the number of following
+        // pages loaded along with the faulting one. Otherwise, load it alone.
+        if(!zeroFill){
+            if(pageIndex == nextSequentialPage)
+                faultAround = minn(maxx(2 * faultAround, 1u), MAX_FAULT_AROUND);
+            else
+                faultAround = 0;
+        }
+
+        // The following pages must be stored in the same place as this one,
+        // not be zero-fill nor in memory already as shared pages, and get
+        // free frames: prefetching never evicts a page.
+        int frames[MAX_FAULT_AROUND + 1];
+        frames[0] = physIndex;
+        unsigned count = 1;
+        unsigned state = pageTable[pageIndex].virtualPage;
+        while(!zeroFill && count <= faultAround && pageIndex + count < numPages
+                && pageTable[pageIndex + count].virtualPage == state){
+            if(state == numPages && (BackedBytes(pageIndex + count) == 0
+                 || (IsSharedPage(pageIndex + count)
+                       && coreMap -> FindSharedPage(fileId, pageIndex + count)
+                            != -1)))
+                break;
+            int frame = coreMap -> ReserveFreePage(pageIndex + count);
+            if(frame == -1)
+                break;
+            coreMap -> PinPage(frame);
+            pageTable[pageIndex + count].physicalPage = frame;
+            machine -> GetMMU() -> InvalidateDecodedPage(frame);
+            frames[count++] = frame;
+        }
+        stats -> numPrefetchedPages += count - 1;
+        if(!zeroFill)
+            nextSequentialPage = pageIndex + count;
+
+        // If the pages were never loaded to memory. Those of the executable
+        // are then shared, read-only, with other address spaces running it.
+        if(state == numPages){
+            LoadPagesFirst(pageIndex, count, frames);
+            for(unsigned i = 0; i < count; i++)
+                if(IsSharedPage(pageIndex + i)){
+                    coreMap -> MakeShared(frames[i], fileId);
+                    pageTable[pageIndex + i].readOnly = true;
+                }
+        }
+        // If the pages are in the swap file.
+        else if(state == numPages + 1)
+            LoadPagesSwap(pageIndex, count, frames);
+
+        for(unsigned i = 0; i < count; i++)
+            coreMap -> UnpinPage(frames[i]);
+    #else
+        // If the page was never loaded to memory.
+        if(pageTable[pageIndex].virtualPage == numPages)
+            LoadPagesFirst(pageIndex, 1, &physIndex);
     #endif
+    return true;
 }
 
 #ifdef DEMAND_LOADING
-/// Loads a page that is currently in the swap file to memory.
-void
-AddressSpace::LoadPageSwap(unsigned int pageIndex, int physIndex)
+// Returns true if the page holds part of the code or initialized data of the
+// executable, so that it is the same for every address space running it.
+bool
+AddressSpace::IsSharedPage(unsigned pageIndex)
 {
-    DEBUG('w', "Loading page from swap for the %dth time\n", swapCount++);
+    return BackedBytes(pageIndex) > 0;
+}
 
-    char *mainMemory = machine -> GetMMU() -> mainMemory;
-    unsigned memoryPosition = physIndex * PAGE_SIZE;
-    unsigned fileOffset = pageIndex * PAGE_SIZE;
+// Gives this address space its own copy of a shared page, after a write to
+// it. Returns false if the page is not shared, so the write is not allowed,
+// or if no frame could be freed for the copy.
+bool
+AddressSpace::CopyOnWrite(unsigned pageIndex)
+{
+    if(pageIndex >= numPages || pageTable[pageIndex].virtualPage != pageIndex
+         || !pageTable[pageIndex].readOnly)
+        return false;
 
-    // Load the page onto memory.
-    swapFile -> ReadAt(&mainMemory[memoryPosition], PAGE_SIZE, fileOffset);
+    // The TLB entry maps the page read-only.
+    #ifdef USE_TLB
+        tlb_handler -> DropPage(this, pageIndex);
+    #endif
 
-    // Set the page as loaded.
-    pageTable[pageIndex].virtualPage = pageIndex;
-    pageTable[pageIndex].physicalPage = physIndex;
-    pageTable[pageIndex].valid = true;
+    unsigned sharedIndex = pageTable[pageIndex].physicalPage;
+    if(coreMap -> SharerCount(sharedIndex) == 1)
+        // Nobody else maps it anymore, so it can just be taken.
+        coreMap -> MakePrivate(sharedIndex);
+    else{
+        // Keep the contents aside: reserving a frame may evict the shared
+        // page once we no longer map it.
+        char *mainMemory = machine -> GetMMU() -> mainMemory;
+        char contents[PAGE_SIZE];
+        memcpy(contents, &mainMemory[sharedIndex * PAGE_SIZE], PAGE_SIZE);
+        coreMap -> LeaveSharedPage(sharedIndex, this);
+        pageTable[pageIndex].virtualPage = numPages;
+
+        int physIndex = coreMap -> ReservePage(pageIndex);
+        if(physIndex == -1)
+            return false;
+        machine -> GetMMU() -> InvalidateDecodedPage(physIndex);
+        memcpy(&mainMemory[physIndex * PAGE_SIZE], contents, PAGE_SIZE);
+
+        // The copy matches the executable until written, so it starts clean.
+        pageTable[pageIndex].virtualPage = pageIndex;
+        pageTable[pageIndex].physicalPage = physIndex;
+        pageTable[pageIndex].use = false;
+        pageTable[pageIndex].dirty = false;
+    }
     pageTable[pageIndex].readOnly = false;
-    pageTable[pageIndex].use = false;
-    pageTable[pageIndex].dirty = false;
+    stats -> numCopiesOnWrite++;
+    return true;
+}
+
+/// Loads `count` consecutive pages, starting at `firstPage`, that are
+/// currently in the swap file, into the frames in `frames`.
+void
+AddressSpace::LoadPagesSwap(unsigned firstPage, unsigned count,
+                            const int *frames)
+{
+    ASSERT(firstPage + count <= numPages);
+
+    char *mainMemory = machine -> GetMMU() -> mainMemory;
+
+    for(unsigned i = 0; i < count; ){
+        // Pages of a cluster have consecutive slots, so they are read with
+        // a single ReadAt and then copied each to its frame.
+        unsigned page = firstPage + i;
+        ASSERT(swapWritten[page]);
+        unsigned run = 1;
+        while(i + run < count
+                && swapSlot[page + run] == swapSlot[page] + (int) run)
+            run++;
+
+        DEBUG('w', "Loading %u pages from swap for the %dth time\n",
+              run, swapCount++);
+
+        if(run == 1)
+            swapManager -> ReadSlot(swapSlot[page],
+                                    &mainMemory[frames[i] * PAGE_SIZE]);
+        else{
+            char *buffer = new char [run * PAGE_SIZE];
+            swapManager -> ReadSlots(swapSlot[page], run, buffer);
+            for(unsigned j = 0; j < run; j++)
+                memcpy(&mainMemory[frames[i + j] * PAGE_SIZE],
+                       &buffer[j * PAGE_SIZE], PAGE_SIZE);
+            delete [] buffer;
+        }
+        stats -> numSwapReads += run;
+
+        // Set the pages as loaded.
+        for(unsigned j = i; j < i + run; j++){
+            pageTable[firstPage + j].virtualPage = firstPage + j;
+            pageTable[firstPage + j].physicalPage = frames[j];
+            pageTable[firstPage + j].valid = true;
+            pageTable[firstPage + j].readOnly = false;
+            pageTable[firstPage + j].use = false;
+            pageTable[firstPage + j].dirty = false;
+        }
+        i += run;
+    }
 }
 #endif
-/// Loads a page that was never loaded to memory before, to memory.
+/// Loads `count` consecutive pages, starting at `firstPage`, that were
+/// never loaded to memory before, into the frames in `frames`.
 void
-AddressSpace::LoadPageFirst(unsigned int pageIndex, int physIndex)
+AddressSpace::LoadPagesFirst(unsigned firstPage, unsigned count,
+                             const int *frames)
 {
-    ASSERT(pageIndex < numPages);
+    ASSERT(firstPage + count <= numPages);
+
+    char *mainMemory = machine -> GetMMU() -> mainMemory;
 
-    pageTable[pageIndex].virtualPage = pageIndex;
+    for(unsigned i = 0; i < count; i++){
+        pageTable[firstPage + i].virtualPage = firstPage + i;
+        pageTable[firstPage + i].use = false;
+        pageTable[firstPage + i].dirty = false;
+        pageTable[firstPage + i].readOnly = false;
+
+        // Frames keep the contents of their previous page, so zero whatever
+        // part of the page the executable does not fill. Pages of the
+        // uninitialized data and the stack only get this.
+        unsigned backed = BackedBytes(firstPage + i);
+        if(backed < PAGE_SIZE)
+            memset(&mainMemory[frames[i] * PAGE_SIZE], 0, PAGE_SIZE);
+        if(backed == 0)
+            stats -> numZeroFillPages++;
+    }
+
+    LoadSegment(ourNoffHeader.code, firstPage, count, frames);
+    LoadSegment(ourNoffHeader.initData, firstPage, count, frames);
+}
 
-    // Start and end adresses of the page.
-    // [pageStart, pageEnd)
+/// Returns the number of bytes of the page that the code and initialized
+/// data segments of the executable fill.
+unsigned
+AddressSpace::BackedBytes(unsigned pageIndex)
+{
     unsigned pageStart = pageIndex * PAGE_SIZE;
     unsigned pageEnd = pageStart + PAGE_SIZE;
+    unsigned backed = 0;
+
+    // The segments do not overlap, so their parts in the page add up.
+    const noffSegment *segments[] = {
+        &ourNoffHeader.code, &ourNoffHeader.initData
+    };
+    for(unsigned i = 0; i < 2; i++){
+        unsigned maxStart = maxx(pageStart, segments[i] -> virtualAddr);
+        unsigned minEnd = minn(pageEnd,
+                               segments[i] -> virtualAddr + segments[i] -> size);
+        if(maxStart < minEnd)
+            backed += minEnd - maxStart;
+    }
+    return backed;
+}
 
-    // Check for intersection with code segment.
-    // [codeStart, codeEnd)
-    unsigned codeStart = ourNoffHeader.code.virtualAddr;
-    unsigned codeEnd = codeStart + ourNoffHeader.code.size;
-    unsigned maxStart = maxx(pageStart, codeStart);
-    unsigned minEnd = minn(pageEnd, codeEnd);
+/// Loads the part of `segment` that falls in `count` consecutive pages,
+/// starting at `firstPage`, into the frames in `frames`.  That part is read
+/// from the executable with a single `ReadAt`, whatever the number of pages.
+void
+AddressSpace::LoadSegment(const noffSegment &segment, unsigned firstPage,
+                          unsigned count, const int *frames)
+{
+    // Start and end adresses of the pages.
+    // [rangeStart, rangeEnd)
+    unsigned rangeStart = firstPage * PAGE_SIZE;
+    unsigned rangeEnd = rangeStart + count * PAGE_SIZE;
+
+    // Check for intersection with the segment.
+    // [segmentStart, segmentEnd)
+    unsigned segmentStart = segment.virtualAddr;
+    unsigned segmentEnd = segmentStart + segment.size;
+    unsigned maxStart = maxx(rangeStart, segmentStart);
+    unsigned minEnd = minn(rangeEnd, segmentEnd);
+    if(maxStart >= minEnd)
+        return;
+
+    // The intersection is [maxStart, minEnd).
+    // Calculate the starting position of the intersection in the file.
+    unsigned fileOffset = segment.inFileAddr + (maxStart - segmentStart);
     char *mainMemory = machine -> GetMMU() -> mainMemory;
 
-    if(maxStart < minEnd){
-        // The intersection is [maxStart, minEnd).
-        // Calculate the starting position of the intersection in the file.
-        unsigned fileOffset = ourNoffHeader.code.inFileAddr
-                              + (maxStart - codeStart);
-
-        // Calculate the starting position of the intersection in the
-        // main memory.
-        unsigned memoryPosition = physIndex * PAGE_SIZE
-                                  + maxStart - pageStart;
-
-        // Load the intersection from the file onto memory.
+    // A single page goes straight into its frame.
+    if(count == 1){
+        unsigned memoryPosition = frames[0] * PAGE_SIZE
+                                  + maxStart - rangeStart;
         ourExecutable -> ReadAt(&mainMemory[memoryPosition],
                                 minEnd - maxStart, fileOffset);
+        return;
     }
 
-    // Check for intersection with data segment.
-    // [dataStart, dataEnd)
-    unsigned dataStart = ourNoffHeader.initData.virtualAddr;
-    unsigned dataEnd = dataStart + ourNoffHeader.initData.size;
-    maxStart = maxx(pageStart, dataStart);
-    minEnd = minn(pageEnd, dataEnd);
-
-    if(maxStart < minEnd){
-        // The intersection is [maxStart, minEnd).
-        // Calculate the starting position of the intersection in the file.
-        unsigned fileOffset = ourNoffHeader.initData.inFileAddr
-                              + (maxStart - dataStart);
-
-        // Calculate the starting position of the intersection in the
-        // main memory.
-        unsigned memoryPosition = physIndex * PAGE_SIZE
-                                  + maxStart - pageStart;
-
-        // Load the intersection from the file onto memory.
-        ourExecutable -> ReadAt(&mainMemory[memoryPosition],
-                                minEnd - maxStart, fileOffset);
+    // Otherwise the frames are not contiguous, so read everything at once
+    // and then copy each piece to its frame.
+    char *buffer = new char [minEnd - maxStart];
+    ourExecutable -> ReadAt(buffer, minEnd - maxStart, fileOffset);
+
+    for(unsigned addr = maxStart; addr < minEnd; ){
+        unsigned offset = addr % PAGE_SIZE;
+        unsigned amount = minn(PAGE_SIZE - offset, minEnd - addr);
+        unsigned memoryPosition = frames[addr / PAGE_SIZE - firstPage]
+                                  * PAGE_SIZE + offset;
+
+        memcpy(&mainMemory[memoryPosition], &buffer[addr - maxStart], amount);
+        addr += amount;
     }
+    delete [] buffer;
 }
 
 // Copies the information from the pageTable at index pageIndex to destPage.
@@ -467,6 +750,18 @@ AddressSpace::CopyPageContent(unsigned pageIndex, TranslationEntry* destPage)
     *destPage = pageTable[pageIndex];
 }
 
+unsigned
+AddressSpace::GetASID()
+{
+    return asid;
+}
+
+void
+AddressSpace::SetASID(unsigned newAsid)
+{
+    asid = newAsid;
+}
+
 // Returns the frame index of a given virtual page that is loaded in memory.
 // If the page corresponding to pageIndex is not loaded, the function
 // returns -1.
@@ -487,3 +782,18 @@ AddressSpace::SetPageFlags(unsigned pageIndex, bool use, bool dirty){
 	pageTable[pageIndex].dirty = dirty;
 }
 
+bool
+AddressSpace::TestAndClearUse(unsigned pageIndex){
+    ASSERT(pageIndex < numPages);
+
+    bool used = pageTable[pageIndex].use;
+    pageTable[pageIndex].use = false;
+
+    // The TLB entry of the page, if any, holds the most recent flags.
+    #ifdef USE_TLB
+        if(tlb_handler -> TestAndClearUse(this, pageIndex))
+            used = true;
+    #endif
+    return used;
+}
+
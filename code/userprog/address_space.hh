@@ -17,6 +17,17 @@
 #include "filesys/file_system.hh"
 #include "machine/translation_entry.hh"
 #include "bin/noff.h"
+
+
+#ifdef DEMAND_LOADING
+// Maximum number of pages loaded after a faulting one, when the program
+// goes through its pages sequentially.
+const unsigned MAX_FAULT_AROUND = 8;
+
+// Pages get swap slots in aligned groups of this many, laid out in a row, so
+// that pages loaded together are read back from swap together.
+const unsigned SWAP_CLUSTER = MAX_FAULT_AROUND;
+#endif
 #include "userprog/syscall.h"
 #include "filesys/open_file.hh"
 
@@ -53,8 +64,9 @@ public:
     bool NotLoadedPage(unsigned pageIndex);
 
     // Loads a page to the main memory, iff it isn't already loaded.
-    // (if it is, it does nothing).
-    void LoadPage(unsigned pageIndex);
+    // (if it is, it does nothing). Returns false if no frame could be freed
+    // for it, because the swap area is full.
+    bool LoadPage(unsigned pageIndex);
 
     // Copies the information from the pageTable at index pageIndex to destPage.
     void CopyPageContent(unsigned pageIndex, TranslationEntry* destPage);
@@ -68,10 +80,35 @@ public:
     void SetPageFlags(unsigned pageIndex, bool use, bool dirty);
 
     #ifdef DEMAND_LOADING
-        // Stores the page in the swap file.
-        void SwapPage(unsigned pageIndex);
+        // Gives this address space its own copy of a shared page, after a
+        // write to it. Returns false if the page is not shared, so the write
+        // is not allowed, or if no frame could be freed for the copy.
+        bool CopyOnWrite(unsigned pageIndex);
+    #endif
+
+    // Returns whether the page referenced by pageIndex was used since the
+    // last call, and clears its use flag, both in the pageTable and in the TLB.
+    bool TestAndClearUse(unsigned pageIndex);
+
+    #ifdef DEMAND_LOADING
+        // Removes the page from memory, storing it in the swap file if it
+        // was modified. Returns false, leaving it in memory, if that is
+        // needed and the swap area is full.
+        bool SwapPage(unsigned pageIndex);
+
+        // Writes the page to its swap slot if it was modified, and marks it
+        // clean, leaving it in memory. Returns whether it was written; it is
+        // not if the swap area is full.
+        bool CleanPage(unsigned pageIndex);
     #endif
 
+    // Returns the ASID that tags the TLB entries of this address space, or
+    // NUM_ASIDS if it was never given one.
+    unsigned GetASID();
+
+    // Sets the ASID of this address space. Only the TLB handler hands them out.
+    void SetASID(unsigned newAsid);
+
 private:
 
     // pageTable[i].virtualPage = numPages means the page i has never
@@ -92,17 +129,60 @@ private:
     // User space to which this Address Space belongs.
     SpaceId spaceId;
 
+    // ASID of this address space in the TLB.
+    unsigned asid;
+
     #ifdef DEMAND_LOADING
-        // Swap file information.
-        char *swapFileName;
-        OpenFile *swapFile;
+        // swapSlot[i] is the slot of the swap area set aside for page i, or
+        // -1 if it has none yet. The first page of a cluster to be written
+        // to swap gets slots for the whole cluster. swapWritten[i] tells
+        // whether the slot holds a copy of the page. A clean page with such
+        // a copy can then be dropped from memory and read back from there;
+        // otherwise it is read back from the executable.
+        int *swapSlot;
+        bool *swapWritten;
+
+        // Number of pages after a faulting one that were loaded along with
+        // it, and the page where the next fault lands if the program keeps
+        // going sequentially.
+        unsigned faultAround;
+        unsigned nextSequentialPage;
+
+        // Identifies the executable, to find pages of it that other address
+        // spaces already loaded.
+        unsigned long fileId;
+
+        // Returns true if the page holds part of the code or initialized
+        // data of the executable, so that it is the same for every address
+        // space running it. Those pages are shared, read-only, and copied
+        // on the first write.
+        bool IsSharedPage(unsigned pageIndex);
     #endif
 
-    /// Loads a page that was never loaded to memory before, to memory.
-    void LoadPageFirst(unsigned pageIndex, int physIndex);
+    /// Loads `count` consecutive pages, starting at `firstPage`, that were
+    /// never loaded to memory before, into the frames in `frames`.
+    void LoadPagesFirst(unsigned firstPage, unsigned count,
+                        const int *frames);
+
+    /// Returns the number of bytes of the page that the code and initialized
+    /// data segments of the executable fill.
+    unsigned BackedBytes(unsigned pageIndex);
 
-    /// Loads a page that is currently in the swap file to memory.
-    void LoadPageSwap(unsigned pageIndex, int physIndex);
+    /// Loads the part of `segment` that falls in `count` consecutive pages,
+    /// starting at `firstPage`, into the frames in `frames`.
+    void LoadSegment(const noffSegment &segment, unsigned firstPage,
+                     unsigned count, const int *frames);
+
+    #ifdef DEMAND_LOADING
+        /// Loads `count` consecutive pages, starting at `firstPage`, that
+        /// are currently in the swap file, into the frames in `frames`.
+        void LoadPagesSwap(unsigned firstPage, unsigned count,
+                           const int *frames);
+
+        /// Writes the page to its swap slot, setting one aside first if it
+        /// has none.  Returns false if the swap area is full.
+        bool WriteSwapSlot(unsigned pageIndex);
+    #endif
 };
 
 
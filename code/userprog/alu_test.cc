@@ -0,0 +1,200 @@
+/// Differential test for the arithmetic of the MIPS simulator.
+///
+/// Compares the native implementations in `machine/alu.hh` against the
+/// original bit-by-bit multiplication and sign-based overflow checks, over
+/// a set of corner cases and random operands.
+
+
+#include "machine/alu.hh"
+#include "machine/encoding.hh"
+#include "threads/system.hh"
+
+
+/// Original R2000 multiplication: check `a`'s bits one at a time, and add
+/// in a shifted value of `b`.
+static void
+ReferenceMult(int a, int b, bool signedArith, int *hiPtr, int *loPtr)
+{
+    if (a == 0 || b == 0) {
+        *hiPtr = *loPtr = 0;
+        return;
+    }
+
+    bool negative = false;
+    if (signedArith) {
+        if (a < 0) {
+            negative = !negative;
+            a = -a;
+        }
+        if (b < 0) {
+            negative = !negative;
+            b = -b;
+        }
+    }
+
+    unsigned bLo = b;
+    unsigned bHi = 0;
+    unsigned lo = 0;
+    unsigned hi = 0;
+    for (unsigned i = 0; i < 32; i++) {
+        if (a & 1) {
+            lo += bLo;
+            if (lo < bLo)
+                hi += 1;
+            hi += bHi;
+            if ((a & 0xFFFFFFFE) == 0)
+                break;
+        }
+        bHi <<= 1;
+        if (bLo & 0x80000000)
+            bHi |= 1;
+
+        bLo <<= 1;
+        a >>= 1;
+    }
+
+    if (negative) {
+        hi = ~hi;
+        lo = ~lo;
+        lo++;
+        if (lo == 0)
+            hi++;
+    }
+
+    *hiPtr = (int) hi;
+    *loPtr = (int) lo;
+}
+
+/// Original R2000 division.  The most negative number divided by -1 traps
+/// on the host, so it must not be passed here.
+static void
+ReferenceDivide(int a, int b, bool signedArith, int *hiPtr, int *loPtr)
+{
+    if (b == 0) {
+        *loPtr = 0;
+        *hiPtr = 0;
+    } else if (signedArith) {
+        *loPtr = a / b;
+        *hiPtr = a % b;
+    } else {
+        *loPtr = (int) ((unsigned) a / (unsigned) b);
+        *hiPtr = (int) ((unsigned) a % (unsigned) b);
+    }
+}
+
+/// Original overflow checks for `ADD` and `SUB`, done on wrapped-around
+/// unsigned results.
+static bool
+ReferenceAddOverflows(int a, int b)
+{
+    int sum = (int) ((unsigned) a + (unsigned) b);
+    return !((a ^ b) & SIGN_BIT) && (a ^ sum) & SIGN_BIT;
+}
+
+static bool
+ReferenceSubOverflows(int a, int b)
+{
+    int diff = (int) ((unsigned) a - (unsigned) b);
+    return (a ^ b) & SIGN_BIT && (a ^ diff) & SIGN_BIT;
+}
+
+/// Check one pair of operands with every operation; return the number of
+/// mismatches found.
+static unsigned
+CheckOperands(int a, int b)
+{
+    unsigned failed = 0;
+
+    for (int s = 0; s < 2; s++) {
+        bool signedArith = s == 1;
+        int hi, lo, refHi, refLo;
+
+        Mult(a, b, signedArith, &hi, &lo);
+        ReferenceMult(a, b, signedArith, &refHi, &refLo);
+        if (hi != refHi || lo != refLo) {
+            printf("MULT%s 0x%X, 0x%X: got 0x%X:0x%X, expected 0x%X:0x%X\n",
+                   signedArith ? "" : "U", a, b, hi, lo, refHi, refLo);
+            failed++;
+        }
+
+        if (signedArith && a == INT32_MIN && b == -1)
+            continue;
+        Divide(a, b, signedArith, &hi, &lo);
+        ReferenceDivide(a, b, signedArith, &refHi, &refLo);
+        if (hi != refHi || lo != refLo) {
+            printf("DIV%s 0x%X, 0x%X: got 0x%X:0x%X, expected 0x%X:0x%X\n",
+                   signedArith ? "" : "U", a, b, hi, lo, refHi, refLo);
+            failed++;
+        }
+    }
+
+    int result;
+    bool overflow = AddOverflows(a, b, &result);
+    if (overflow != ReferenceAddOverflows(a, b)
+          || (unsigned) result != (unsigned) a + (unsigned) b) {
+        printf("ADD 0x%X, 0x%X: wrong result or overflow\n", a, b);
+        failed++;
+    }
+    overflow = SubOverflows(a, b, &result);
+    if (overflow != ReferenceSubOverflows(a, b)
+          || (unsigned) result != (unsigned) a - (unsigned) b) {
+        printf("SUB 0x%X, 0x%X: wrong result or overflow\n", a, b);
+        failed++;
+    }
+
+    return failed;
+}
+
+static int
+RandomWord()
+{
+    return (int) ((unsigned) Random() << 16 ^ (unsigned) Random());
+}
+
+/// Run the differential test over `count` random pairs of operands, plus
+/// every pair of corner cases.
+void
+AluTest(unsigned count)
+{
+    static const int CORNERS[] = {
+        0, 1, -1, 2, -2, 7, -7, INT32_MAX, INT32_MIN, INT32_MAX - 1,
+        INT32_MIN + 1, 0x10000, -0x10000, 0xFFFF, 0x7FFF
+    };
+    static const unsigned NUM_CORNERS = sizeof CORNERS / sizeof CORNERS[0];
+
+    unsigned failed = 0;
+    unsigned checked = 0;
+
+    for (unsigned i = 0; i < NUM_CORNERS; i++)
+        for (unsigned j = 0; j < NUM_CORNERS; j++) {
+            failed += CheckOperands(CORNERS[i], CORNERS[j]);
+            checked++;
+        }
+
+    for (unsigned i = 0; i < count; i++) {
+        int a = RandomWord();
+        int b = RandomWord();
+
+        // Also exercise small operands, which take other paths through the
+        // reference multiplication.
+        if (i % 4 == 1)
+            b >>= 20;
+        else if (i % 4 == 2)
+            a >>= 24;
+        failed += CheckOperands(a, b);
+        checked++;
+    }
+
+    // The overflowing division is not checked against the reference, which
+    // would trap.
+    int hi, lo;
+    Divide(INT32_MIN, -1, true, &hi, &lo);
+    if (lo != INT32_MIN || hi != 0) {
+        printf("DIV 0x80000000, -1: got 0x%X:0x%X\n", hi, lo);
+        failed++;
+    }
+
+    printf("ALU test: %u operand pairs checked, %u mismatches.\n",
+           checked, failed);
+    ASSERT(failed == 0);
+}
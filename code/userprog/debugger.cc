@@ -18,7 +18,7 @@ typedef DebuggerCommandManager DCM;
 static inline void
 PrintPrompt()
 {
-    const char PROMPT[] = "%u> ";
+    const char PROMPT[] = "%llu> ";
 
     printf(PROMPT, stats->totalTicks);
     fflush(stdout);
@@ -272,7 +272,7 @@ CommandTick(char **args, void *runUntilTime_)
         return DCM::RUN_RESULT_STAY;
     }
 
-    unsigned *runUntilTime = (unsigned *) runUntilTime_;
+    unsigned long long *runUntilTime = (unsigned long long *) runUntilTime_;
     *runUntilTime = stats->totalTicks + num;
     return DCM::RUN_RESULT_STEP;
 }
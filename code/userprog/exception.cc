@@ -104,9 +104,11 @@ PageFaultHandler(ExceptionType et)
         #ifdef DEMAND_LOADING
         // If the frame corresponding to the virtual page is not loaded into memory
         // (either because it hasn't been loaded yet or because it is in the swap file),
-        // then load it first.
-        if(currentSpace -> NotLoadedPage(newPageIndex))
-			currentSpace -> LoadPage(newPageIndex);
+        // then load it first. If it cannot get a frame, because the swap
+        // area is full, the thread is finished too.
+        if(currentSpace -> NotLoadedPage(newPageIndex)
+             && !currentSpace -> LoadPage(newPageIndex))
+            currentThread -> Finish();
         #endif
 
 		// Replace a TLB entry with the data corresponding to the virtual page.
@@ -117,6 +119,23 @@ PageFaultHandler(ExceptionType et)
 static void
 ReadOnlyHandler(ExceptionType et)
 {
+    #ifdef DEMAND_LOADING
+    // A write to a page shared with other processes gets its own copy of the
+    // page, which is then writable.
+    int vAddr = machine -> ReadRegister(BAD_VADDR_REG);
+    AddressSpace* currentSpace = currentThread -> GetAddressSpace();
+    int pageIndex = currentSpace -> FindContainingPageIndex(vAddr);
+
+    if(pageIndex >= 0 && currentSpace -> CopyOnWrite(pageIndex)){
+        // Without a TLB, the MMU reads the page table, which CopyOnWrite
+        // already updated.
+        #ifdef USE_TLB
+            tlb_handler -> ReplaceTLBEntry(pageIndex);
+        #endif
+        return;
+    }
+    #endif
+
 	// If the program tried to write into read only memory, finish its execution
 	// as if it caused a Segmentation Fault.
 	currentThread -> Finish();
@@ -211,7 +230,9 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
-        // Read `size` bytes from an open file into a user string.
+        // Read up to `size` bytes from an open file into a user buffer.
+        // Reading from the console stops at the first newline, which is
+        // stored as a null character.  File reads are not terminated.
         // Returns the number of bytes read.
         // If it fails, it returns -1 instead.
         case SC_READ: {
@@ -225,24 +246,34 @@ SyscallHandler(ExceptionType _et)
                 break;
             }
 
-            char *buffer = new char [readSize+1];
+            if(readSize <= 0){
+                DEBUG('a', "Error: readSize is not positive.\n");
+                machine -> WriteRegister(2, -1);
+                break;
+            }
 
             int readBytes = 0;
 
             // Check if reading from the console was specified.
             if(fileId == CONSOLE_INPUT){
-                int ind;
-                for(ind = 0; ind < readSize; ind++){
-                    buffer[ind] = synchConsole -> GetChar();
-                    if(buffer[ind] == '\n')
-                        break;
+                // The newline is not counted.  A line that fills the
+                // buffer is not terminated.
+                char c = '\0';
+                while(readBytes < readSize
+                        && (c = synchConsole -> GetChar()) != '\n'){
+                    WriteBufferToUser(&c, bufferAddr + readBytes, 1);
+                    readBytes++;
+                }
+                if(c == '\n'){
+                    c = '\0';
+                    WriteBufferToUser(&c, bufferAddr + readBytes, 1);
                 }
-                buffer[ind] = 0;
-                readBytes = ind;
             }else{
                 if(currentThread -> HasFile(fileId)){
+                    // The data goes straight into the frames of the user
+                    // buffer.
                     OpenFile *filePtr = currentThread -> GetFile(fileId);
-                    readBytes = filePtr -> Read(buffer, readSize);
+                    readBytes = ReadFileToUser(filePtr, bufferAddr, readSize);
                 }else{
                     DEBUG('a', "Error: file with id %d is not open.\n",
                           fileId);
@@ -251,16 +282,14 @@ SyscallHandler(ExceptionType _et)
                 }
             }
 
-            WriteStringToUser(buffer, bufferAddr);
             machine -> WriteRegister(2, readBytes);
             DEBUG('a', "Requested to read %d bytes from file at position %d\n",
             readSize, fileId);
-
-            delete [] buffer;
             break;
         }
 
-        // Write `size` bytes from a user string into an open file.
+        // Write `size` bytes from a user buffer into an open file.
+        // Writing to the console stops at the first null character.
         // Returns the number of bytes written.
         // If it fails, it returns -1 instead.
         case SC_WRITE: {
@@ -274,44 +303,47 @@ SyscallHandler(ExceptionType _et)
                 break;
             }
 
-            if(writeSize == 0){
-                DEBUG('a', "Error: writeSize is 0.\n");
-                machine -> WriteRegister(2, -1);
-                break;
-            }
-
-            char *buffer = new char [writeSize + 1];
-
-            if (!ReadStringFromUser(bufferAddr, buffer, writeSize+1)){
-                DEBUG('a', "Error: buffer string too long (maximum is %u bytes).\n",
-                      writeSize+1);
+            if(writeSize <= 0){
+                DEBUG('a', "Error: writeSize is not positive.\n");
                 machine -> WriteRegister(2, -1);
                 break;
             }
 
-            int writtenBytes;
+            int writtenBytes = 0;
 
             // Check if reading to the console was specified.
             if(fileId == CONSOLE_OUTPUT){
-                int ind;
-                for(ind = 0; ind < writeSize and buffer[ind]; ind++)
-                    synchConsole -> PutChar(buffer[ind]);
-                writtenBytes = ind;
+                // Copied a page at a time, as PutChar may switch threads.
+                char chunk[PAGE_SIZE];
+                bool stop = false;
+                while(writtenBytes < writeSize && !stop){
+                    int size = writeSize - writtenBytes;
+                    if(size > (int) PAGE_SIZE)
+                        size = PAGE_SIZE;
+                    stop = ReadStringFromUser(bufferAddr + writtenBytes,
+                                              chunk, size);
+                    for(int ind = 0; ind < size && chunk[ind]; ind++){
+                        synchConsole -> PutChar(chunk[ind]);
+                        writtenBytes++;
+                    }
+                }
             }else{
                 if(currentThread -> HasFile(fileId)){
+                    // The data goes straight from the frames of the user
+                    // buffer.
                     OpenFile *filePtr = currentThread -> GetFile(fileId);
-                    writtenBytes = filePtr -> Write(buffer, writeSize);
+                    writtenBytes = WriteFileFromUser(filePtr, bufferAddr,
+                                                     writeSize);
                 }else{
                     DEBUG('a', "Error: file with id %d not open.\n", fileId);
                     machine -> WriteRegister(2, -1);
+                    break;
                 }
             }
 
             machine -> WriteRegister(2, writtenBytes);
             DEBUG('a', "Requested to write %d bytes to the file at position %d\n",
                   writeSize, fileId);
-
-            delete [] buffer;
             break;
         }
 
@@ -420,6 +452,46 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
+        // Give tickets to a user program, for stride scheduling.
+        // Returns 0 if successful, -1 otherwise.
+        case SC_TICKETS: {
+            SpaceId spaceId = machine -> ReadRegister(4);
+            unsigned tickets = machine -> ReadRegister(5);
+
+            if(spaceId < 0 or not threadTable -> HasKey(spaceId)){
+                DEBUG('a', "Error: Thread with id %d not found.\n", spaceId);
+                machine -> WriteRegister(2, -1);
+                break;
+            }
+
+            if(tickets == 0 or tickets > MAX_TICKETS){
+                DEBUG('a', "Error: invalid amount of tickets %u.\n", tickets);
+                machine -> WriteRegister(2, -1);
+                break;
+            }
+
+            scheduler -> SetTickets(threadTable -> Get(spaceId), tickets);
+            machine -> WriteRegister(2, 0);
+            break;
+        }
+
+        // Set the time slice of a user program, in ticks.
+        // Returns 0 if successful, -1 otherwise.
+        case SC_SLICE: {
+            SpaceId spaceId = machine -> ReadRegister(4);
+            unsigned ticks = machine -> ReadRegister(5);
+
+            if(spaceId < 0 or not threadTable -> HasKey(spaceId)){
+                DEBUG('a', "Error: Thread with id %d not found.\n", spaceId);
+                machine -> WriteRegister(2, -1);
+                break;
+            }
+
+            threadTable -> Get(spaceId) -> SetTimeSlice(ticks);
+            machine -> WriteRegister(2, 0);
+            break;
+        }
+
         default:
             fprintf(stderr, "Unexpected system call: id %d.\n", scid);
             ASSERT(false);
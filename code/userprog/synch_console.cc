@@ -1,4 +1,5 @@
 #include "synch_console.hh"
+#include "threads/system.hh"
 
 void ReadAvailProxy(void* data){
     ASSERT(data != nullptr);
@@ -31,13 +32,13 @@ SynchConsole::~SynchConsole()
 void SynchConsole::PutChar(char ch){
     writerLock -> Acquire();
     console -> PutChar(ch);
-    writerSem -> P();
+    scheduler -> WaitForDevice(writerSem);
     writerLock -> Release();
 }
 
 char SynchConsole::GetChar(){
     readerLock -> Acquire();
-    readerSem -> P();
+    scheduler -> WaitForDevice(readerSem);
     char returnValue = console -> GetChar();
     readerLock -> Release();
     return returnValue;
@@ -25,6 +25,8 @@
 #define SC_JOIN     3
 #define SC_FORK     4
 #define SC_YIELD    5
+#define SC_TICKETS  6
+#define SC_SLICE    7
 #define SC_CREATE  10
 #define SC_REMOVE  11
 #define SC_OPEN    12
@@ -80,6 +82,20 @@ void Fork(void (*func)(void));
 /// or not.
 void Yield();
 
+/// Give `tickets` tickets to the user program `id`, which fix its share of
+/// the CPU under stride scheduling (`-st`).  Every program starts with 100.
+///
+/// Return 0 if successful, or -1 if the user program is not found or
+/// `tickets` is 0.
+int Tickets(SpaceId id, unsigned tickets);
+
+/// Let the user program `id` run for `ticks` ticks before it can be
+/// preempted.  Every program starts with the slice given with `-ts`, and
+/// zero preempts it on every timer interrupt.
+///
+/// Return 0 if successful, or -1 if the user program is not found.
+int TimeSlice(SpaceId id, unsigned ticks);
+
 
 /// File system operations: `Create`, `Open`, `Read`, `Write`, `Close`.
 ///
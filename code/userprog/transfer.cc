@@ -1,21 +1,26 @@
 #include "transfer.hh"
 #include "lib/utility.hh"
 #include "threads/system.hh"
+#include "filesys/open_file.hh"
 
-bool tryReadMem(unsigned userAddress, unsigned size, int* buffer){
-    for(unsigned i = 0; i < 3; i++)
-        if(machine->ReadMem(userAddress, size, buffer))
-            return true;
-    
-    return false;
-}
+#include <string.h>
+
+
+// Translate the bytes from `userAddress` up to the end of its page, but no
+// more than `byteCount`, letting the kernel handle any fault on the way.
+// Returns the number of bytes that can be copied at `*physAddress`.
+static unsigned tryTranslate(unsigned userAddress, unsigned byteCount,
+                             bool writing, unsigned *physAddress){
+    unsigned size = PAGE_SIZE - userAddress % PAGE_SIZE;
+    if(size > byteCount)
+        size = byteCount;
 
-bool tryWriteMem(unsigned userAddress, unsigned size, int value){
     for(unsigned i = 0; i < 3; i++)
-        if(machine->WriteMem(userAddress, size, value))
-            return true;
-        
-    return false;
+        if(machine->TranslateRange(userAddress, size, writing, physAddress))
+            return size;
+
+    ASSERT(false);
+    return 0;
 }
 
 
@@ -27,10 +32,16 @@ void ReadBufferFromUser(int userAddress, char *outBuffer,
     ASSERT(outBuffer != nullptr);
     ASSERT(byteCount != 0);
 
-    for(unsigned count = 0; count < byteCount; count++, userAddress++){
-        int temp;
-        ASSERT(tryReadMem(userAddress, 1, &temp));
-        *outBuffer = (unsigned char) temp;
+    // One translation per page; the page cannot be evicted in the middle of
+    // the copy, as nothing here yields the CPU.
+    while(byteCount > 0){
+        unsigned physAddress;
+        unsigned size = tryTranslate(userAddress, byteCount, false,
+                                     &physAddress);
+        memcpy(outBuffer, &machine->GetMMU()->mainMemory[physAddress], size);
+        userAddress += size;
+        outBuffer += size;
+        byteCount -= size;
     }
 }
 
@@ -42,15 +53,23 @@ bool ReadStringFromUser(int userAddress, char *outString,
     ASSERT(outString != nullptr);
     ASSERT(maxByteCount != 0);
 
-    unsigned count = 0;
-    do {
-        int temp;
-        count++;
-        ASSERT(tryReadMem(userAddress++, 1, &temp));
-        *outString = (unsigned char) temp;
-    } while (*outString++ != '\0' && count < maxByteCount);
+    while(maxByteCount > 0){
+        unsigned physAddress;
+        unsigned size = tryTranslate(userAddress, maxByteCount, false,
+                                     &physAddress);
+        const char *source = &machine->GetMMU()->mainMemory[physAddress];
+        const char *end = (const char *) memchr(source, '\0', size);
+        if(end != nullptr){
+            memcpy(outString, source, end - source + 1);
+            return true;
+        }
+        memcpy(outString, source, size);
+        userAddress += size;
+        outString += size;
+        maxByteCount -= size;
+    }
 
-    return *(outString - 1) == '\0';
+    return false;
 }
 
 /// Copy a byte array from host to virtual machine.
@@ -61,8 +80,17 @@ void WriteBufferToUser(const char *buffer, int userAddress,
     ASSERT(buffer != nullptr);
     ASSERT(byteCount != 0);
 
-    for(unsigned count = 0; count < byteCount; count++, userAddress++, buffer++)
-        ASSERT(tryWriteMem(userAddress, 1, *buffer));
+    // Translating for writing takes care of read-only (copy on write)
+    // pages and marks the page as dirty.
+    while(byteCount > 0){
+        unsigned physAddress;
+        unsigned size = tryTranslate(userAddress, byteCount, true,
+                                     &physAddress);
+        memcpy(&machine->GetMMU()->mainMemory[physAddress], buffer, size);
+        userAddress += size;
+        buffer += size;
+        byteCount -= size;
+    }
 }
 
 /// Copy a C string from host to virtual machine.
@@ -70,7 +98,74 @@ void WriteStringToUser(const char *string, int userAddress){
     ASSERT(userAddress != 0);
     ASSERT(string != nullptr);
 
-    do {
-        ASSERT(tryWriteMem(userAddress++, 1, *string));
-    } while (*string++ != '\0');
+    WriteBufferToUser(string, userAddress, strlen(string) + 1);
+}
+
+// The file system may block while transferring a page, letting other threads
+// run and take frames; the page stays pinned meanwhile so it is not evicted.
+static void pinFrame(unsigned physAddress){
+    #ifdef DEMAND_LOADING
+        coreMap -> PinPage(physAddress / PAGE_SIZE);
+    #endif
+}
+
+static void unpinFrame(unsigned physAddress){
+    #ifdef DEMAND_LOADING
+        coreMap -> UnpinPage(physAddress / PAGE_SIZE);
+    #endif
+}
+
+/// Read from a file into virtual machine memory, a page at a time, with no
+/// intermediate buffer.
+unsigned ReadFileToUser(OpenFile *file, int userAddress, unsigned byteCount){
+    ASSERT(file != nullptr);
+    ASSERT(userAddress != 0);
+
+    unsigned total = 0;
+    while(byteCount > 0){
+        unsigned physAddress;
+        unsigned size = tryTranslate(userAddress, byteCount, true,
+                                     &physAddress);
+        pinFrame(physAddress);
+        int count = file -> Read(&machine->GetMMU()->mainMemory[physAddress],
+                                 size);
+        unpinFrame(physAddress);
+
+        if(count <= 0)
+            break;
+        total += count;
+        if((unsigned) count < size)
+            break;
+        userAddress += size;
+        byteCount -= size;
+    }
+    return total;
+}
+
+/// Write from virtual machine memory into a file, a page at a time, with no
+/// intermediate buffer.
+unsigned WriteFileFromUser(OpenFile *file, int userAddress,
+                           unsigned byteCount){
+    ASSERT(file != nullptr);
+    ASSERT(userAddress != 0);
+
+    unsigned total = 0;
+    while(byteCount > 0){
+        unsigned physAddress;
+        unsigned size = tryTranslate(userAddress, byteCount, false,
+                                     &physAddress);
+        pinFrame(physAddress);
+        int count = file -> Write(&machine->GetMMU()->mainMemory[physAddress],
+                                  size);
+        unpinFrame(physAddress);
+
+        if(count <= 0)
+            break;
+        total += count;
+        if((unsigned) count < size)
+            break;
+        userAddress += size;
+        byteCount -= size;
+    }
+    return total;
 }
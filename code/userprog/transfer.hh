@@ -7,6 +7,8 @@
 #define NACHOS_USERPROG_TRANSFER__HH
 
 
+class OpenFile;
+
 /// Copy a byte array from virtual machine to host.
 void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount);
@@ -21,5 +23,14 @@ void WriteBufferToUser(const char *buffer, int userAddress, unsigned byteCount);
 /// Copy a C string from host to virtual machine.
 void WriteStringToUser(const char *string, int userAddress);
 
+/// Read up to `byteCount` bytes from `file` straight into virtual machine
+/// memory.  Return the number of bytes actually read.
+unsigned ReadFileToUser(OpenFile *file, int userAddress, unsigned byteCount);
+
+/// Write `byteCount` bytes of virtual machine memory straight into `file`.
+/// Return the number of bytes actually written.
+unsigned WriteFileFromUser(OpenFile *file, int userAddress,
+                           unsigned byteCount);
+
 
 #endif
@@ -3,50 +3,100 @@
 #include "coremap.hh"
 #include "threads/system.hh"
 
-CoreMap::CoreMap(){
-    #ifdef LRU
+static const char *POLICY_NAMES[NUM_PAGE_POLICIES] = {
+    "fifo", "lru", "clock"
+};
+
+CoreMap::CoreMap(PagePolicy pagePolicy){
+    ASSERT(pagePolicy < NUM_PAGE_POLICIES);
+
+    policy = pagePolicy;
+    stats -> pagePolicy = POLICY_NAMES[policy];
+
+    idleCounter = nullptr;
+    if(policy == PAGE_LRU){
         idleCounter = new unsigned int [NUM_PHYS_PAGES];
-    #else
-        nextRemoved = 0;
-    #endif
+        for(unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+            idleCounter[i] = 0;
+    }
+    nextRemoved = 0;
+    lowWatermark = highWatermark = 0;
+    pagerWakeUp = nullptr;
+    pagerAwake = false;
     pageMap = new Bitmap(NUM_PHYS_PAGES);
     ownerAddSp = new AddressSpace* [NUM_PHYS_PAGES];
     virtualPageNum = new unsigned int [NUM_PHYS_PAGES];
+    sharedFile = new unsigned long [NUM_PHYS_PAGES];
+    sharers = new List<AddressSpace*> [NUM_PHYS_PAGES];
+    pinCount = new unsigned int [NUM_PHYS_PAGES];
+    for(unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+        pinCount[i] = 0;
 }
 
 CoreMap::~CoreMap(){
-    #ifdef LRU
-        delete [] idleCounter;
-    #endif
-
+    delete [] idleCounter;
     delete pageMap;
     delete [] ownerAddSp;
     delete [] virtualPageNum;
+    delete [] sharedFile;
+    delete [] sharers;
+    delete [] pinCount;
+    delete pagerWakeUp;
+}
+
+
+const char *
+CoreMap::PolicyName(PagePolicy pagePolicy)
+{
+    ASSERT(pagePolicy < NUM_PAGE_POLICIES);
+    return POLICY_NAMES[pagePolicy];
 }
 
+bool
+CoreMap::PolicyFromName(const char *name, PagePolicy *pagePolicy)
+{
+    ASSERT(name != nullptr && pagePolicy != nullptr);
+
+    for(unsigned i = 0; i < NUM_PAGE_POLICIES; i++)
+        if(!strcmp(name, POLICY_NAMES[i])){
+            *pagePolicy = (PagePolicy) i;
+            return true;
+        }
+    return false;
+}
 
 // Reserves a physical page and returns the index. If all pages are already
-// assigned, it chooses one to send to the swap file. The method used for
-// this is LRU if the LRU compilation flag is defined. Otherwise, it uses
-// FIFO.
-unsigned int
+// assigned, it chooses one to send to the swap file, according to the
+// replacement policy. Returns -1 if the page chosen is dirty and the swap
+// area is full.
+int
 CoreMap::ReservePage(unsigned int virtualPage){
-    int index = pageMap -> Find();
+    // Wake the pager up if free frames are running low. This has to come
+    // first: V may switch to another thread, and no other thread may run
+    // between reserving a frame and pinning it.
+    if(pagerWakeUp != nullptr && !pagerAwake
+         && pageMap -> CountClear() <= lowWatermark){
+        pagerAwake = true;
+        pagerWakeUp -> V();
+    }
 
-    // If the pageMap is full
-    if(index == -1){
-        #ifdef LRU
-            // LRU.
-            index = FindLRU();
-        #else
-            // FIFO.
-            index = nextRemoved;
-            nextRemoved = (nextRemoved + 1)%NUM_PHYS_PAGES;
-        #endif
+    int index = ReserveFreePage(virtualPage);
+    if(index != -1)
+        return index;
 
-        // Send the currently loaded page to the swap file.
-        ownerAddSp[index] -> SwapPage(virtualPageNum[index]);
-    }
+    // If the pageMap is full, evict a page right here. If the pager cleaned
+    // it already, this does not write anything. If it is dirty and the swap
+    // area is full, give up: other victims would be pages loaded more
+    // recently, and taking their frames soon ends in pages of the faulting
+    // program evicting each other forever.
+    // The frame is pinned while the page is written, so that no other
+    // thread picks it too.
+    index = FindVictim();
+    PinPage(index);
+    bool evicted = EvictPage(index);
+    UnpinPage(index);
+    if(!evicted)
+        return -1;
 
     // Store the values of the page to be stored.
     ownerAddSp[index] = currentThread -> GetAddressSpace();
@@ -55,20 +105,269 @@ CoreMap::ReservePage(unsigned int virtualPage){
     return index;
 }
 
+// Reserves a physical page and returns the index, only if there is one
+// free. Returns -1 otherwise.
+int
+CoreMap::ReserveFreePage(unsigned int virtualPage){
+    int index = pageMap -> Find();
+
+    if(index != -1){
+        ownerAddSp[index] = currentThread -> GetAddressSpace();
+        virtualPageNum[index] = virtualPage;
+    }
+    return index;
+}
+
 
 // Makes all previously reserved pages of a given Address Space available.
+// Shared pages stay reserved while other address spaces map them.
 void
 CoreMap::ReleasePages(AddressSpace* currentSpace){
+    for(unsigned i = 0; i < NUM_PHYS_PAGES; i++){
+        if(!pageMap -> Test(i))
+            continue;
+
+        if(sharers[i].IsEmpty()){
+            if(ownerAddSp[i] == currentSpace)
+                pageMap -> Clear(i);
+        } else if(sharers[i].Has(currentSpace)){
+            if(sharers[i].Length() == 1){
+                sharers[i].Pop();
+                pageMap -> Clear(i);
+            } else
+                LeaveSharedPage(i, currentSpace);
+        }
+    }
+}
+
+// Marks the page in frame index, just loaded from executable fileId by its
+// owner, as shared.
+void
+CoreMap::MakeShared(unsigned int index, unsigned long fileId){
+    ASSERT(pageMap -> Test(index) && sharers[index].IsEmpty());
+
+    sharedFile[index] = fileId;
+    sharers[index].Append(ownerAddSp[index]);
+}
+
+// Returns the frame holding virtual page virtualPage of executable fileId,
+// if it is shared, or -1 otherwise.
+int
+CoreMap::FindSharedPage(unsigned long fileId, unsigned int virtualPage){
     for(unsigned i = 0; i < NUM_PHYS_PAGES; i++)
-        if(ownerAddSp[i] == currentSpace)
-            pageMap -> Clear(i);
+        if(pageMap -> Test(i) && !sharers[i].IsEmpty()
+             && sharedFile[i] == fileId && virtualPageNum[i] == virtualPage)
+            return i;
+    return -1;
 }
 
-#ifdef LRU
+// Adds space to the address spaces mapping the shared page in frame index.
+void
+CoreMap::JoinSharedPage(unsigned int index, AddressSpace *space){
+    ASSERT(!sharers[index].IsEmpty() && !sharers[index].Has(space));
+
+    sharers[index].Append(space);
+}
+
+// Returns the number of address spaces mapping the page in frame index.
+unsigned int
+CoreMap::SharerCount(unsigned int index){
+    ASSERT(pageMap -> Test(index));
+
+    return sharers[index].IsEmpty() ? 1 : sharers[index].Length();
+}
+
+// Removes space from the address spaces mapping the shared page in frame
+// index. The frame stays shared, so others must be mapping it too.
+void
+CoreMap::LeaveSharedPage(unsigned int index, AddressSpace *space){
+    ASSERT(sharers[index].Length() > 1 && sharers[index].Has(space));
+
+    sharers[index].Remove(space);
+
+    // Hand the frame over to another of them.
+    if(ownerAddSp[index] == space){
+        ownerAddSp[index] = sharers[index].Pop();
+        sharers[index].Prepend(ownerAddSp[index]);
+    }
+}
+
+// Turns the shared page in frame index, mapped by its owner only, into a
+// private one.
+void
+CoreMap::MakePrivate(unsigned int index){
+    ASSERT(sharers[index].Length() == 1);
+
+    sharers[index].Pop();
+}
+
+// Returns whether the page in frame index was used since the last call, by
+// any address space mapping it, and clears its use flags.
+bool
+CoreMap::TestAndClearUse(unsigned int index){
+    if(sharers[index].IsEmpty())
+        return ownerAddSp[index] -> TestAndClearUse(virtualPageNum[index]);
+
+    // Go once around the list, clearing every flag.
+    bool used = false;
+    for(unsigned n = sharers[index].Length(); n > 0; n--){
+        AddressSpace *space = sharers[index].Pop();
+        if(space -> TestAndClearUse(virtualPageNum[index]))
+            used = true;
+        sharers[index].Append(space);
+    }
+    return used;
+}
+
+// Keeps the page in frame index in memory until a matching UnpinPage.
+void
+CoreMap::PinPage(unsigned int index){
+    ASSERT(pageMap -> Test(index));
+
+    pinCount[index]++;
+}
+
+void
+CoreMap::UnpinPage(unsigned int index){
+    ASSERT(pinCount[index] > 0);
+
+    pinCount[index]--;
+}
+
+// Returns whether the frame at index holds a page that can be evicted.
+bool
+CoreMap::IsEvictable(unsigned int index){
+    return pageMap -> Test(index) && pinCount[index] == 0;
+}
+
+// Chooses a reserved page to evict, according to the replacement policy.
+unsigned int
+CoreMap::FindVictim(){
+    ASSERT(pageMap -> CountClear() < NUM_PHYS_PAGES);
+
+    unsigned int index = 0;
+    switch(policy){
+        case PAGE_FIFO: {
+            // Skip the frames that are free or pinned, going around once at
+            // most.
+            unsigned int n = 0;
+            while(n < NUM_PHYS_PAGES && !IsEvictable(nextRemoved)){
+                nextRemoved = (nextRemoved + 1)%NUM_PHYS_PAGES;
+                n++;
+            }
+            ASSERT(n < NUM_PHYS_PAGES);
+            index = nextRemoved;
+            nextRemoved = (nextRemoved + 1)%NUM_PHYS_PAGES;
+            break;
+        }
+
+        case PAGE_LRU:
+            index = FindLRU();
+            break;
+
+        case PAGE_CLOCK:
+            index = FindClock();
+            break;
+
+        default:
+            ASSERT(false);
+    }
+    return index;
+}
+
+// Sends the page at the given index to the swap file. The frame stays
+// reserved. Returns false, leaving the page in place, if it is dirty and the
+// swap area is full.
+bool
+CoreMap::EvictPage(unsigned int index){
+    ASSERT(pageMap -> Test(index));
+
+    // A shared page is read-only, so it is just dropped by everyone mapping
+    // it.
+    if(!sharers[index].IsEmpty()){
+        while(!sharers[index].IsEmpty())
+            sharers[index].Pop() -> SwapPage(virtualPageNum[index]);
+    } else if(!ownerAddSp[index] -> SwapPage(virtualPageNum[index]))
+        return false;
+
+    stats -> numPageEvictions++;
+    return true;
+}
+
+static void
+PagerThread(void *arg){
+    ((CoreMap *) arg) -> RunPager();
+}
+
+// Starts the pager thread, with the given free frame watermarks.
+void
+CoreMap::StartPager(unsigned int low, unsigned int high){
+    ASSERT(pagerWakeUp == nullptr);
+    ASSERT(low < high && high < NUM_PHYS_PAGES);
+
+    lowWatermark = low;
+    highWatermark = high;
+    pagerWakeUp = new Semaphore("pager", 0);
+
+    Thread *pager = new Thread("pager");
+    pager -> Fork(PagerThread, (void *) this);
+}
+
+// Body of the pager thread; never returns.
+void
+CoreMap::RunPager(){
+    unsigned int *order = new unsigned int [NUM_PHYS_PAGES];
+    for(;;){
+        pagerWakeUp -> P();
+
+        // Clean the frames most likely to be evicted next. Each one is
+        // pinned while it is written, so it is not evicted halfway, and it
+        // stays in memory afterwards.
+        unsigned int count = CleaningOrder(order);
+        unsigned int reclaimable = pageMap -> CountClear();
+        for(unsigned int i = 0; i < count && reclaimable < highWatermark; i++){
+            unsigned int index = order[i];
+            if(!IsEvictable(index))
+                continue;
+
+            PinPage(index);
+            if(ownerAddSp[index] -> CleanPage(virtualPageNum[index]))
+                stats -> numPagerCleanings++;
+            UnpinPage(index);
+            reclaimable++;
+        }
+        pagerAwake = false;
+    }
+}
+
+// Stores in order the evictable frames, roughly in the order the
+// replacement policy will pick them, and returns how many there are. FIFO
+// and clock go around from the hand; LRU goes from the most idle frame down.
+unsigned int
+CoreMap::CleaningOrder(unsigned int *order){
+    unsigned int count = 0;
+    for(unsigned int n = 0; n < NUM_PHYS_PAGES; n++){
+        unsigned int index = (nextRemoved + n)%NUM_PHYS_PAGES;
+        if(!IsEvictable(index))
+            continue;
+
+        unsigned int pos = count++;
+        if(policy == PAGE_LRU)
+            for(; pos > 0 && idleCounter[order[pos - 1]] < idleCounter[index];
+                  pos--)
+                order[pos] = order[pos - 1];
+        order[pos] = index;
+    }
+    return count;
+}
 
 // Sets idleCounter to 0 at the given index and increases the rest by 1.
+// Does nothing unless the policy is LRU.
 void
 CoreMap::UpdateIdleCounter(unsigned int loadedIndex){
+    if(policy != PAGE_LRU)
+        return;
+
     for(unsigned int ind = 0; ind < NUM_PHYS_PAGES; ind++)
         if(ind == loadedIndex)
             idleCounter[ind] = 0;
@@ -76,20 +375,38 @@ CoreMap::UpdateIdleCounter(unsigned int loadedIndex){
             idleCounter[ind]++;
 }
 
-// Finds the index with the highest idleCounter.
+// Finds the evictable index with the highest idleCounter.
 unsigned int
 CoreMap::FindLRU(){
     unsigned int lru = 0;
     unsigned int maxIdle = 0;
+    bool found = false;
     for(unsigned int ind = 0; ind < NUM_PHYS_PAGES; ind++)
-        if(idleCounter[ind] > maxIdle){
+        if(IsEvictable(ind) && (!found || idleCounter[ind] > maxIdle)){
             lru = ind;
             maxIdle = idleCounter[ind];
+            found = true;
         }
 
+    ASSERT(found);
     return lru;
 }
 
-#endif
+// Advances the clock hand until it finds a page that was not used since the
+// hand last passed over it, and returns its index. Free and pinned frames
+// are skipped. Since each page skipped loses its use bit, an evictable page
+// turns up within two full turns.
+unsigned int
+CoreMap::FindClock(){
+    for(unsigned int n = 0; n < 2 * NUM_PHYS_PAGES; n++){
+        unsigned int index = nextRemoved;
+        nextRemoved = (nextRemoved + 1)%NUM_PHYS_PAGES;
+
+        if(IsEvictable(index) && !TestAndClearUse(index))
+            return index;
+    }
+    ASSERT(false);
+    return 0;
+}
 
 #endif
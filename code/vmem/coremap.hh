@@ -6,6 +6,19 @@
 #include "machine/mmu.hh"
 #include "lib/bitmap.hh"
 #include "threads/thread.hh"
+#include "threads/synch.hh"
+#include "lib/list.hh"
+
+// Replacement policies for physical pages, used once every frame is taken.
+enum PagePolicy {
+    PAGE_FIFO,   // Frames in the order they were loaded.
+    PAGE_LRU,    // Exact least recently used. Every TLB hit costs
+                 // O(NUM_PHYS_PAGES).
+    PAGE_CLOCK,  // Second chance over the use bits of the pages. Accesses
+                 // cost nothing extra, and each eviction clears use bits
+                 // until it finds a page not used since the last pass.
+    NUM_PAGE_POLICIES
+};
 
 class CoreMap{
 private:
@@ -16,36 +29,134 @@ private:
     AddressSpace  **ownerAddSp;
     unsigned int *virtualPageNum;
 
+    // Pages loaded from an executable are shared by every address space
+    // running it, read-only. For such a frame i, sharedFile[i] identifies
+    // the executable and sharers[i] lists the address spaces mapping it,
+    // ownerAddSp[i] among them. The list is empty for private frames.
+    unsigned long *sharedFile;
+    List<AddressSpace*> *sharers;
+
+    // Returns whether the page in frame index was used since the last call,
+    // by any address space mapping it, and clears its use flags.
+    bool TestAndClearUse(unsigned int index);
+
+    // pinCount[i] counts the kernel transfers going on straight into or out
+    // of frame i: system calls reading or writing user buffers, and pages
+    // being loaded or evicted. They may block, so the frame cannot be
+    // evicted meanwhile.
+    unsigned int *pinCount;
+
+    // Returns whether the frame at index holds a page that can be evicted.
+    bool IsEvictable(unsigned int index);
+
+    PagePolicy policy;
+
+    // Used for LRU. idleCounter[i] counts the amount times there was a memory
+    // access not involving the physical page i. The last accessed page has
+    // value 0.
+    unsigned int *idleCounter;
+
+    // Used for FIFO, and as the hand of the clock.
+    unsigned int nextRemoved;
+
+    // Pager thread. When a fault leaves lowWatermark or fewer free frames,
+    // it is woken up and writes dirty pages back to swap, next victims
+    // first, until highWatermark frames are free or hold clean pages. Those
+    // stay in memory, but evicting them needs no write, so faults usually
+    // only have to read. pagerWakeUp is nullptr if there is no pager.
+    unsigned int lowWatermark;
+    unsigned int highWatermark;
+    Semaphore *pagerWakeUp;
+    bool pagerAwake;
+
+    // Chooses a reserved page to evict, according to the replacement policy.
+    unsigned int FindVictim();
+
+    // Sends the page at the given index to the swap file. The frame stays
+    // reserved. Returns false, leaving the page in place, if it is dirty
+    // and the swap area is full.
+    bool EvictPage(unsigned int index);
+
+    // Stores in order the evictable frames, roughly in the order the
+    // replacement policy will pick them, and returns how many there are.
+    unsigned int CleaningOrder(unsigned int *order);
+
+    // Finds the evictable index with the highest idleCounter.
+    unsigned int FindLRU();
+
+    // Advances the clock hand until it finds a page that was not used since
+    // the hand last passed over it, and returns its index.
+    unsigned int FindClock();
+
+public:
+    // The default policy is LRU if the LRU compilation flag is defined, and
+    // FIFO otherwise.
     #ifdef LRU
-        // idleCounter[i] counts the amount times there was a memory access not
-        // involving the physical page i. The last accessed page has value 0.
-        unsigned int *idleCounter;
+        CoreMap(PagePolicy pagePolicy = PAGE_LRU);
     #else
-        // Used for FIFO.
-        unsigned int nextRemoved;
+        CoreMap(PagePolicy pagePolicy = PAGE_FIFO);
     #endif
 
-public:
-    CoreMap();
-
     ~CoreMap();
 
     // Reserves a physical page and returns the index. If all pages are already
-    // assigned, it chooses one to send to the swap file. The method used for
-    // this is LRU if the LRU compilation flag is defined. Otherwise, it uses
-    // FIFO.
-    unsigned int ReservePage(unsigned int virtualPage);
+    // assigned, it chooses one to send to the swap file, according to the
+    // replacement policy. Returns -1 if the page chosen is dirty and the swap
+    // area is full.
+    int ReservePage(unsigned int virtualPage);
+
+    // Reserves a physical page and returns the index, only if there is one
+    // free. Returns -1 otherwise.
+    int ReserveFreePage(unsigned int virtualPage);
 
     // Makes all previously reserved pages of a given Address Space available.
+    // Shared pages stay reserved while other address spaces map them.
     void ReleasePages(AddressSpace* currentSpace);
 
-    #ifdef LRU
-        // Sets idleCounter to 0 at the given index and increases the rest by 1.
-        void UpdateIdleCounter(unsigned int loadedIndex);
+    // Marks the page in frame index, just loaded from executable fileId by
+    // its owner, as shared.
+    void MakeShared(unsigned int index, unsigned long fileId);
 
-        // Finds the index with the highest idleCounter.
-        unsigned int FindLRU();
-    #endif
+    // Returns the frame holding virtual page virtualPage of executable
+    // fileId, if it is shared, or -1 otherwise.
+    int FindSharedPage(unsigned long fileId, unsigned int virtualPage);
+
+    // Adds space to the address spaces mapping the shared page in frame
+    // index.
+    void JoinSharedPage(unsigned int index, AddressSpace *space);
+
+    // Returns the number of address spaces mapping the page in frame index.
+    unsigned int SharerCount(unsigned int index);
+
+    // Removes space from the address spaces mapping the shared page in frame
+    // index. The frame stays shared, so others must be mapping it too.
+    void LeaveSharedPage(unsigned int index, AddressSpace *space);
+
+    // Turns the shared page in frame index, mapped by its owner only, into a
+    // private one.
+    void MakePrivate(unsigned int index);
+
+    // Keeps the page in frame index in memory until a matching UnpinPage.
+    void PinPage(unsigned int index);
+
+    void UnpinPage(unsigned int index);
+
+    // Starts the pager thread, with the given free frame watermarks.
+    void StartPager(unsigned int low, unsigned int high);
+
+    // Body of the pager thread; never returns.
+    void RunPager();
+
+    // Sets idleCounter to 0 at the given index and increases the rest by 1.
+    // Does nothing unless the policy is LRU.
+    void UpdateIdleCounter(unsigned int loadedIndex);
+
+    // Returns the name of a policy, as accepted by PolicyFromName.
+    static const char *PolicyName(PagePolicy pagePolicy);
+
+    // Stores in pagePolicy the policy called name. Returns false if there is
+    // no such policy.
+    static bool PolicyFromName(const char *name, PagePolicy *pagePolicy);
 };
 
 #endif
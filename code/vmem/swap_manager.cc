@@ -0,0 +1,111 @@
+#ifdef DEMAND_LOADING
+
+#include "swap_manager.hh"
+#include "threads/system.hh"
+
+static const char *SWAP_FILE_NAME = "SWAP";
+
+SwapManager::SwapManager(unsigned numSlots){
+    ASSERT(numSlots > 0 && numSlots <= NUM_SWAP_SLOTS);
+
+    #ifdef FILESYS_STUB
+        // The file starts empty, and grows as slots are written.
+        bool created = fileSystem -> Create(SWAP_FILE_NAME, 0);
+        ASSERT(created);
+        swapFile = fileSystem -> Open(SWAP_FILE_NAME);
+        ASSERT(swapFile != nullptr);
+    #else
+        // The file holds the first sector and the length of the area.
+        ASSERT(PAGE_SIZE == SECTOR_SIZE);
+        unsigned area[2];
+        OpenFile *record = fileSystem -> Open(SWAP_FILE_NAME);
+        if(record == nullptr){
+            // Halve the request until the free map has a run that long.
+            int first;
+            while((first = fileSystem -> ReserveSectors(numSlots)) == -1){
+                numSlots /= 2;
+                ASSERT(numSlots > 0);
+            }
+            area[0] = first;
+            area[1] = numSlots;
+
+            bool created = fileSystem -> Create(SWAP_FILE_NAME, sizeof area);
+            ASSERT(created);
+            record = fileSystem -> Open(SWAP_FILE_NAME);
+            ASSERT(record != nullptr);
+            record -> WriteAt((const char *) area, sizeof area, 0);
+        } else
+            record -> ReadAt((char *) area, sizeof area, 0);
+        delete record;
+
+        ASSERT(area[1] > 0 && area[0] + area[1] <= NUM_SECTORS);
+        firstSector = area[0];
+        numSlots = area[1];
+    #endif
+
+    slotMap = new Bitmap(numSlots);
+}
+
+SwapManager::~SwapManager(){
+    #ifdef FILESYS_STUB
+        delete swapFile;
+        fileSystem -> Remove(SWAP_FILE_NAME);
+    #endif
+    delete slotMap;
+}
+
+// Reserves a free slot and returns its index, or -1 if the swap area is
+// full.
+int
+SwapManager::AllocateSlot(){
+    return AllocateSlots(1);
+}
+
+// Reserves count consecutive free slots and returns the index of the first,
+// or -1 if there is no such run.
+int
+SwapManager::AllocateSlots(unsigned count){
+    ASSERT(count > 0);
+    return slotMap -> FindRun(count);
+}
+
+// Makes a slot available again.
+void
+SwapManager::FreeSlot(unsigned slot){
+    ASSERT(slotMap -> Test(slot));
+    slotMap -> Clear(slot);
+}
+
+// Copies a page from memory, at from, into the given slot.
+void
+SwapManager::WriteSlot(unsigned slot, const char *from){
+    ASSERT(slotMap -> Test(slot));
+    #ifdef FILESYS_STUB
+        swapFile -> WriteAt(from, PAGE_SIZE, slot * PAGE_SIZE);
+    #else
+        synchDisk -> WriteSector(firstSector + slot, from);
+    #endif
+}
+
+// Copies the page stored in the given slot into memory, at into.
+void
+SwapManager::ReadSlot(unsigned slot, char *into){
+    ReadSlots(slot, 1, into);
+}
+
+// Copies the pages stored in count consecutive slots, starting at first,
+// into memory, at into. The stub does it with a single read.
+void
+SwapManager::ReadSlots(unsigned first, unsigned count, char *into){
+    for(unsigned i = first; i < first + count; i++)
+        ASSERT(slotMap -> Test(i));
+    #ifdef FILESYS_STUB
+        swapFile -> ReadAt(into, count * PAGE_SIZE, first * PAGE_SIZE);
+    #else
+        for(unsigned i = 0; i < count; i++)
+            synchDisk -> ReadSector(firstSector + first + i,
+                                    &into[i * PAGE_SIZE]);
+    #endif
+}
+
+#endif
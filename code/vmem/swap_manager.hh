@@ -0,0 +1,72 @@
+#ifdef DEMAND_LOADING
+
+#ifndef NACHOS_VMEM_SWAPMANAGER_HH
+#define NACHOS_VMEM_SWAPMANAGER_HH
+
+#include "filesys/open_file.hh"
+#include "lib/bitmap.hh"
+#include "machine/mmu.hh"
+#include "machine/disk.hh"
+
+// Number of pages the swap area can hold, shared by all processes. With the
+// Nachos file system, it takes up to a quarter of the disk.
+#ifdef FILESYS_STUB
+const unsigned NUM_SWAP_SLOTS = 1024;
+#else
+const unsigned NUM_SWAP_SLOTS = NUM_SECTORS / 4;
+#endif
+
+// Manages a single swap area, shared by every address space, split into
+// page-sized slots handed out with a bitmap. Processes thus start and exit
+// without touching the file system.
+//
+// With the stub, the area is a UNIX file. Files of the Nachos file system
+// are far too small, so there it is a run of raw sectors set aside in the
+// free map, one per page. Like a swap partition, it is kept from one run to
+// the next, so it needs no disk access at shutdown; a small file records
+// where it is.
+class SwapManager{
+private:
+    // Used to manage availability of the slots.
+    Bitmap *slotMap;
+
+    #ifdef FILESYS_STUB
+        OpenFile *swapFile;
+    #else
+        unsigned firstSector;
+    #endif
+
+public:
+    // Sets aside room for numSlots pages. Without the stub, it settles for
+    // fewer if the disk has no free run that long, and reuses the area set
+    // aside by a previous run if there is one.
+    SwapManager(unsigned numSlots = NUM_SWAP_SLOTS);
+
+    // Removes the swap file, with the stub.
+    ~SwapManager();
+
+    // Reserves a free slot and returns its index, or -1 if the swap area is
+    // full.
+    int AllocateSlot();
+
+    // Reserves count consecutive free slots and returns the index of the
+    // first, or -1 if there is no such run.
+    int AllocateSlots(unsigned count);
+
+    // Makes a slot available again.
+    void FreeSlot(unsigned slot);
+
+    // Copies a page from memory, at from, into the given slot.
+    void WriteSlot(unsigned slot, const char *from);
+
+    // Copies the page stored in the given slot into memory, at into.
+    void ReadSlot(unsigned slot, char *into);
+
+    // Copies the pages stored in count consecutive slots, starting at first,
+    // into memory, at into. The stub does it with a single read.
+    void ReadSlots(unsigned first, unsigned count, char *into);
+};
+
+#endif
+
+#endif
@@ -2,40 +2,235 @@
 #include "threads/system.hh"
 
 
-TLB_Handler::TLB_Handler(){
-    replaceIndex = 0;
+static const char *POLICY_NAMES[NUM_TLB_POLICIES] = {
+    "fifo", "lru", "random", "clock"
+};
+
+TLB_Handler::TLB_Handler(TLBPolicy tlbPolicy){
+    ASSERT(tlbPolicy < NUM_TLB_POLICIES);
+
+    policy = tlbPolicy;
+    replaceIndex = nullptr;
+    for(unsigned i = 0; i < NUM_ASIDS; i++)
+        asidOwner[i] = nullptr;
+    nextAsid = 0;
+    stats -> tlbPolicy = POLICY_NAMES[policy];
 }
 
 TLB_Handler::~TLB_Handler()
-{}
+{
+    delete [] replaceIndex;
+}
+
+const char *
+TLB_Handler::PolicyName(TLBPolicy tlbPolicy)
+{
+    ASSERT(tlbPolicy < NUM_TLB_POLICIES);
+    return POLICY_NAMES[tlbPolicy];
+}
+
+bool
+TLB_Handler::PolicyFromName(const char *name, TLBPolicy *tlbPolicy)
+{
+    ASSERT(name != nullptr && tlbPolicy != nullptr);
+
+    for(unsigned i = 0; i < NUM_TLB_POLICIES; i++)
+        if(!strcmp(name, POLICY_NAMES[i])){
+            *tlbPolicy = (TLBPolicy) i;
+            return true;
+        }
+    return false;
+}
 
 TranslationEntry *
-TLB_Handler::FindEntryToReplace(){
-    unsigned i;
-    TranslationEntry *tlbRef = machine -> GetMMU() -> tlb;
-    for(i = 0; i < TLB_SIZE; i++)
+TLB_Handler::FindEntryToReplace(unsigned vpn){
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+    unsigned ways = mmu -> GetTLBWays();
+    unsigned set = mmu -> GetTLBSet(vpn);
+
+    // Use a free entry of the set, if there is one.
+    for(unsigned i = set; i < set + ways; i++)
         if(!tlbRef[i].valid)
             return &(tlbRef[i]);
 
-    unsigned returnIndex = replaceIndex;
-    replaceIndex = (replaceIndex + 1) % TLB_SIZE;
-    return &(tlbRef[returnIndex]);
+    if(replaceIndex == nullptr){
+        unsigned numSets = mmu -> GetTLBSize() / ways;
+        replaceIndex = new unsigned [numSets];
+        for(unsigned i = 0; i < numSets; i++)
+            replaceIndex[i] = 0;
+    }
+    unsigned *hand = &replaceIndex[set / ways];
+
+    unsigned victim = 0;
+    switch(policy){
+        case TLB_FIFO:
+            victim = *hand;
+            *hand = (*hand + 1) % ways;
+            break;
+
+        case TLB_LRU:
+            for(unsigned i = 1; i < ways; i++)
+                if(mmu -> GetTLBLastUse(set + i)
+                     < mmu -> GetTLBLastUse(set + victim))
+                    victim = i;
+            break;
+
+        case TLB_RANDOM:
+            victim = Random() % ways;
+            break;
+
+        case TLB_CLOCK:
+            // Give a second chance to every entry used since the hand last
+            // passed over it. This ends after at most one full turn.
+            while(mmu -> TestAndClearTLBReference(set + *hand))
+                *hand = (*hand + 1) % ways;
+            victim = *hand;
+            *hand = (*hand + 1) % ways;
+            break;
+
+        default:
+            ASSERT(false);
+    }
+    return &(tlbRef[set + victim]);
+}
+
+void
+TLB_Handler::WriteBack(TranslationEntry *entry){
+    ASSERT(entry -> valid);
+
+    AddressSpace *owner = asidOwner[entry -> asid];
+    if(owner != nullptr)
+        owner -> SetPageFlags(entry -> virtualPage, entry -> use, entry -> dirty);
+}
+
+void
+TLB_Handler::Flush(){
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+
+    for(unsigned i = 0; i < mmu -> GetTLBSize(); i++)
+        if(tlbRef[i].valid){
+            WriteBack(&tlbRef[i]);
+            tlbRef[i].valid = false;
+        }
+    mmu -> FlushTranslations();
+
+    // The address spaces keep their old ASIDs, but since they no longer own
+    // them they will get new ones when they run again.
+    for(unsigned i = 0; i < NUM_ASIDS; i++)
+        asidOwner[i] = nullptr;
+    nextAsid = 0;
+}
+
+void
+TLB_Handler::ActivateSpace(AddressSpace *space){
+    ASSERT(space != nullptr);
+
+    unsigned asid = space -> GetASID();
+    if(asid >= NUM_ASIDS || asidOwner[asid] != space){
+        if(nextAsid == NUM_ASIDS)
+            Flush();
+        asid = nextAsid++;
+        asidOwner[asid] = space;
+        space -> SetASID(asid);
+    }
+    machine -> GetMMU() -> SetASID(asid);
+}
+
+void
+TLB_Handler::DropPage(AddressSpace *space, unsigned pageIndex){
+    unsigned asid = space -> GetASID();
+    if(asid >= NUM_ASIDS || asidOwner[asid] != space)
+        return;
+
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+    unsigned ways = mmu -> GetTLBWays();
+    unsigned set = mmu -> GetTLBSet(pageIndex);
+
+    for(unsigned i = set; i < set + ways; i++)
+        if(tlbRef[i].valid && tlbRef[i].asid == asid
+             && tlbRef[i].virtualPage == pageIndex){
+            WriteBack(&tlbRef[i]);
+            tlbRef[i].valid = false;
+            mmu -> InvalidateTranslation(pageIndex);
+        }
+}
+
+bool
+TLB_Handler::TestAndClearUse(AddressSpace *space, unsigned pageIndex){
+    unsigned asid = space -> GetASID();
+    if(asid >= NUM_ASIDS || asidOwner[asid] != space)
+        return false;
+
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+    unsigned ways = mmu -> GetTLBWays();
+    unsigned set = mmu -> GetTLBSet(pageIndex);
+
+    bool used = false;
+    for(unsigned i = set; i < set + ways; i++)
+        if(tlbRef[i].valid && tlbRef[i].asid == asid
+             && tlbRef[i].virtualPage == pageIndex){
+            used = used || tlbRef[i].use;
+            tlbRef[i].use = false;
+        }
+    return used;
+}
+
+bool
+TLB_Handler::TestAndClearDirty(AddressSpace *space, unsigned pageIndex){
+    unsigned asid = space -> GetASID();
+    if(asid >= NUM_ASIDS || asidOwner[asid] != space)
+        return false;
+
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+    unsigned ways = mmu -> GetTLBWays();
+    unsigned set = mmu -> GetTLBSet(pageIndex);
+
+    bool dirty = false;
+    for(unsigned i = set; i < set + ways; i++)
+        if(tlbRef[i].valid && tlbRef[i].asid == asid
+             && tlbRef[i].virtualPage == pageIndex){
+            dirty = dirty || tlbRef[i].dirty;
+            tlbRef[i].dirty = false;
+        }
+    return dirty;
+}
+
+void
+TLB_Handler::ReleaseSpace(AddressSpace *space){
+    unsigned asid = space -> GetASID();
+    if(asid >= NUM_ASIDS || asidOwner[asid] != space)
+        return;
+
+    MMU *mmu = machine -> GetMMU();
+    TranslationEntry *tlbRef = mmu -> tlb;
+    for(unsigned i = 0; i < mmu -> GetTLBSize(); i++)
+        if(tlbRef[i].asid == asid){
+            tlbRef[i].valid = false;
+            mmu -> InvalidateTranslation(tlbRef[i].virtualPage);
+        }
+    asidOwner[asid] = nullptr;
 }
 
 void
 TLB_Handler::ReplaceTLBEntry(unsigned newPageIndex){
-	TranslationEntry *oldPage = FindEntryToReplace();
+	TranslationEntry *oldPage = FindEntryToReplace(newPageIndex);
 
     AddressSpace *currentSpace = currentThread -> GetAddressSpace();
 
-	// If the page that is going to be removed is valid (so it maps a frame from the current 
-	// process), then copy its flags to the corresponding pageTable entry.
-	if(oldPage->valid)
-		currentSpace -> SetPageFlags(oldPage -> virtualPage,
-		                             oldPage -> use,
-		                             oldPage -> dirty);
+	// If the page that is going to be removed is valid, then copy its flags
+	// to the pageTable entry of the process it belongs to, which need not
+	// be the current one.
+	if(oldPage->valid){
+		WriteBack(oldPage);
+		machine -> GetMMU() -> InvalidateTranslation(oldPage -> virtualPage);
+	}
 		                             
-    #ifdef LRU
+    #ifdef DEMAND_LOADING
         int physIndex = currentSpace -> GetPhysicalPage(newPageIndex);
 
         // Check that GetPhysicalPage returned successfully.
@@ -47,4 +242,5 @@ TLB_Handler::ReplaceTLBEntry(unsigned newPageIndex){
 
 	// Copy the content from the new page into the corresponding TLB entry.
 	currentSpace -> CopyPageContent(newPageIndex, oldPage);
+	oldPage -> asid = machine -> GetMMU() -> GetASID();
 }
@@ -3,20 +3,79 @@
 
 #include "machine/mmu.hh"
 
+class AddressSpace;
+
+// Replacement policies for the TLB. They only decide among the entries of
+// the set where the new page goes, and only once the set has no free entry.
+enum TLBPolicy {
+    TLB_FIFO,    // Round robin over the entries of the set.
+    TLB_LRU,     // Least recently used entry.
+    TLB_RANDOM,  // Any entry of the set.
+    TLB_CLOCK,   // Second chance: skip entries used since the last pass.
+    NUM_TLB_POLICIES
+};
+
 class TLB_Handler {
 public:
-    TLB_Handler();
+    TLB_Handler(TLBPolicy tlbPolicy = TLB_FIFO);
     ~TLB_Handler();
     
     // Given a virtual page index from the current process, replaces a TLB entry
     // with the page entry corresponding to that index.
     void ReplaceTLBEntry(unsigned newPageIndex);
 
+    // Makes space the one translated by the TLB. Entries are tagged with the
+    // ASID of their address space, so the TLB is not flushed on context
+    // switches, only when every ASID is taken and a new one is needed.
+    void ActivateSpace(AddressSpace *space);
+
+    // Invalidates the TLB entries of virtual page pageIndex of space, copying
+    // their flags to its pageTable first. Called before the page leaves its
+    // frame.
+    void DropPage(AddressSpace *space, unsigned pageIndex);
+
+    // Returns whether the TLB entry of virtual page pageIndex of space, if
+    // any, has its use flag set, and clears it.
+    bool TestAndClearUse(AddressSpace *space, unsigned pageIndex);
+
+    // Returns whether the TLB entry of virtual page pageIndex of space, if
+    // any, has its dirty flag set, and clears it.
+    bool TestAndClearDirty(AddressSpace *space, unsigned pageIndex);
+
+    // Invalidates every TLB entry of space and frees its ASID. Called when
+    // the address space is destroyed.
+    void ReleaseSpace(AddressSpace *space);
+
+    // Returns the name of a policy, as accepted by PolicyFromName.
+    static const char *PolicyName(TLBPolicy tlbPolicy);
+
+    // Stores in tlbPolicy the policy called name. Returns false if there is
+    // no such policy.
+    static bool PolicyFromName(const char *name, TLBPolicy *tlbPolicy);
+
 private:
-    unsigned replaceIndex;
+    TLBPolicy policy;
+
+    // Next entry to look at within each set, for the FIFO and clock
+    // policies. Allocated on first use, since the TLB geometry is set
+    // after the handler is built.
+    unsigned *replaceIndex;
+
+    // Address space that owns each ASID, or nullptr if it is free.
+    AddressSpace *asidOwner[NUM_ASIDS];
+
+    // Next ASID to hand out. When it reaches NUM_ASIDS, the TLB is flushed
+    // and every ASID becomes free again.
+    unsigned nextAsid;
     
-    // Returns a pointer to the entry to be replaced.
-    TranslationEntry* FindEntryToReplace();
+    // Returns a pointer to the entry to be replaced by virtual page vpn.
+    TranslationEntry* FindEntryToReplace(unsigned vpn);
+
+    // Copies the flags of a valid TLB entry to the pageTable of its owner.
+    void WriteBack(TranslationEntry *entry);
+
+    // Invalidates the whole TLB and frees every ASID.
+    void Flush();
 };
 
 